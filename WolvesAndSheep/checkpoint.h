@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// One piece of unfinished work: search the subtree under the tests in
+// "prefix", skipping everything (in depth-first order) before the path
+// given by "resume". An empty "resume" means the whole subtree is unsearched.
+// Both vectors hold tests from depth 0 onward, so "resume" begins with "prefix".
+// Each test is stored as one or more 64-bit words (more when n > 64).
+struct FrontierItem {
+    std::vector<uint64_t> prefix;
+    std::vector<uint64_t> resume;
+};
+
+// A checkpoint file records everything a search for (n,k,t) has yet to do.
+// It's little-endian binary:
+//
+//     "WOLVCKPT"  magic
+//     u32         version (currently 2)
+//     u32 n, k, t
+//     u32         number of 64-bit words per test
+//     u32         number of frontier items
+//     for each item:
+//         u32 prefix length, u32 resume length (in words)
+//         u64 prefix[...], u64 resume[...]
+//
+// We write to a temporary file and rename it into place, so that a crash
+// mid-write leaves the previous checkpoint intact.
+
+static constexpr uint32_t kCheckpointVersion = 2;
+
+inline std::string checkpoint_filename(const std::string& directory, int n, int k, int t)
+{
+    return directory + "/wolves-" + std::to_string(n) + "-" + std::to_string(k) + "-" + std::to_string(t) + ".ckpt";
+}
+
+inline bool write_checkpoint(const std::string& filename, int n, int k, int t, int words_per_test,
+                             const std::vector<FrontierItem>& items)
+{
+    std::string tmpname = filename + ".tmp";
+    FILE *fp = fopen(tmpname.c_str(), "wb");
+    if (fp == nullptr) {
+        return false;
+    }
+    auto put32 = [&](uint32_t x) { fwrite(&x, sizeof x, 1, fp); };
+    auto put_masks = [&](const std::vector<uint64_t>& v) { fwrite(v.data(), sizeof(uint64_t), v.size(), fp); };
+    fwrite("WOLVCKPT", 8, 1, fp);
+    put32(kCheckpointVersion);
+    put32(n);
+    put32(k);
+    put32(t);
+    put32(words_per_test);
+    put32(items.size());
+    for (const FrontierItem& item : items) {
+        put32(item.prefix.size());
+        put32(item.resume.size());
+        put_masks(item.prefix);
+        put_masks(item.resume);
+    }
+    bool ok = (ferror(fp) == 0);
+    ok = (fclose(fp) == 0) && ok;
+    if (ok) {
+        ok = (rename(tmpname.c_str(), filename.c_str()) == 0);
+    }
+    if (!ok) {
+        remove(tmpname.c_str());
+    }
+    return ok;
+}
+
+// Returns false if the file doesn't exist, is malformed, or belongs to some other (n,k,t).
+inline bool read_checkpoint(const std::string& filename, int n, int k, int t, int words_per_test,
+                            std::vector<FrontierItem>& items)
+{
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if (fp == nullptr) {
+        return false;
+    }
+    bool ok = true;
+    auto get32 = [&]() { uint32_t x = 0; ok = ok && (fread(&x, sizeof x, 1, fp) == 1); return x; };
+    auto get_masks = [&](std::vector<uint64_t>& v, uint32_t len) {
+        ok = ok && (len % words_per_test == 0) && (len <= uint32_t(t * words_per_test));
+        if (ok) {
+            v.resize(len);
+            ok = (fread(v.data(), sizeof(uint64_t), len, fp) == len);
+        }
+    };
+    char magic[8] = {};
+    ok = (fread(magic, 8, 1, fp) == 1) && (std::string(magic, 8) == "WOLVCKPT");
+    ok = ok && (get32() == kCheckpointVersion);
+    ok = ok && (get32() == uint32_t(n));
+    ok = ok && (get32() == uint32_t(k));
+    ok = ok && (get32() == uint32_t(t));
+    ok = ok && (get32() == uint32_t(words_per_test));
+    uint32_t count = get32();
+    items.clear();
+    for (uint32_t i = 0; ok && i < count; ++i) {
+        FrontierItem item;
+        uint32_t prefix_len = get32();
+        uint32_t resume_len = get32();
+        get_masks(item.prefix, prefix_len);
+        get_masks(item.resume, resume_len);
+        items.push_back(std::move(item));
+    }
+    fclose(fp);
+    return ok;
+}
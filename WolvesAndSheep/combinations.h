@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cassert>
+#include <limits>
+#include <vector>
+
+// Ranking and unranking arrangements of d wolves among n animals, given as
+// the increasing list of the wolves' indices c[0] < c[1] < ... < c[d-1].
+// Both verifiers step through the arrangements in one of two orders:
+//
+//   colex          all arrangements within {0..m-1} come before any whose
+//                  last wolf is m; rank = sum of C(c[j], j+1).
+//   revolving door Knuth's Algorithm 7.2.1.3R, where each step swaps one wolf
+//                  for another. As in colex, arrangements within {0..m-1}
+//                  come first; then the ones whose last wolf is m, in the
+//                  reverse of the revolving-door order for d-1 wolves
+//                  within {0..m-1}.
+//
+// With the binomial coefficients in a table, either conversion costs
+// O(d log n), so a verifier can start anywhere in the list.
+
+class BinomialTable {
+public:
+    using Int = unsigned long long;
+
+    // C(m,j) for all m <= n and j <= k.
+    explicit BinomialTable(int n, int k) : k_(k), table_((n + 1) * (k + 1), 0) {
+        for (int m = 0; m <= n; ++m) {
+            at(m, 0) = 1;
+            for (int j = 1; j <= k && j <= m; ++j) {
+                Int a = at(m-1, j-1);
+                Int b = at(m-1, j);
+                assert(b <= std::numeric_limits<Int>::max() - a);
+                at(m, j) = a + b;
+            }
+        }
+    }
+
+    Int operator()(int m, int j) const { return table_[m * (k_ + 1) + j]; }
+
+    // The largest x in [lo, hi] such that C(x,j) <= r; C(lo,j) must be <= r.
+    int largest_at_most(Int r, int j, int lo, int hi) const {
+        while (lo < hi) {
+            int mid = lo + (hi - lo + 1) / 2;
+            if ((*this)(mid, j) <= r) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        return lo;
+    }
+
+private:
+    Int& at(int m, int j) { return table_[m * (k_ + 1) + j]; }
+
+    int k_;
+    std::vector<Int> table_;
+};
+
+inline BinomialTable::Int colex_rank(const int *c, int d, const BinomialTable& choose)
+{
+    BinomialTable::Int rank = 0;
+    for (int j = 0; j < d; ++j) {
+        rank += choose(c[j], j + 1);
+    }
+    return rank;
+}
+
+// Fills in c[0..d-1] with the arrangement of d wolves among n animals that has this rank.
+inline void colex_unrank(BinomialTable::Int rank, int n, int d, int *c, const BinomialTable& choose)
+{
+    int hi = n - 1;
+    for (int j = d; j >= 1; --j) {
+        c[j-1] = choose.largest_at_most(rank, j, j - 1, hi);
+        rank -= choose(c[j-1], j);
+        hi = c[j-1] - 1;
+    }
+}
+
+inline BinomialTable::Int revolving_door_rank(const int *c, int d, const BinomialTable& choose)
+{
+    // Unwind revolving_door_unrank, from the first wolf up.
+    BinomialTable::Int rank = 0;
+    for (int j = 1; j <= d; ++j) {
+        rank = choose(c[j-1], j) + (choose(c[j-1], j-1) - 1 - rank);
+    }
+    return rank;
+}
+
+inline void revolving_door_unrank(BinomialTable::Int rank, int n, int d, int *c, const BinomialTable& choose)
+{
+    int hi = n - 1;
+    for (int j = d; j >= 1; --j) {
+        c[j-1] = choose.largest_at_most(rank, j, j - 1, hi);
+        // Our position among the arrangements with this last wolf, which are reversed.
+        rank = choose(c[j-1], j-1) - 1 - (rank - choose(c[j-1], j));
+        hi = c[j-1] - 1;
+    }
+}
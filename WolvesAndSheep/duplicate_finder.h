@@ -0,0 +1,381 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+// Verifying a strategy means checking that no two arrangements of wolves
+// produce the same test results. For C(100,5) arrangements a std::map of
+// results costs tens of GB, so there are three ways to look for a repeat:
+//
+//   Map      a std::set; works for any key type, fine for small problems.
+//   HashSet  an open-addressing table of the raw 64- or 128-bit results,
+//            about 1.5x the size of the results themselves.
+//   Sort     split the arrangements into shards, which threads turn into
+//            sorted runs of results. If they all fit in memory, merge the
+//            runs and look for neighbors that are equal. If not, spill them
+//            to temporary files bucketed by a hash of the result, and then
+//            sort each bucket on its own; only a bucket per thread has to fit.
+//
+// Only Sort uses more than one thread. All of them just report which result
+// repeats; the caller finds the two arrangements behind it with
+// find_ranks_of, which enumerates again but is cheap next to this.
+//
+// "generate(begin, end, emit)" must call emit(results) for the arrangements
+// whose ranks are in [begin, end), in order, stopping early if emit returns
+// false. Sort calls it from several threads at once, on disjoint ranges.
+
+enum class DuplicateEngine { Automatic, Map, HashSet, Sort };
+
+inline const char *duplicate_engine_name(DuplicateEngine e)
+{
+    switch (e) {
+        case DuplicateEngine::Automatic: return "auto";
+        case DuplicateEngine::Map: return "map";
+        case DuplicateEngine::HashSet: return "hash";
+        case DuplicateEngine::Sort: return "sort";
+    }
+    return "?";
+}
+
+// Only plain words of results can be hashed and radix-sorted.
+template<class Key> struct is_word_key : std::false_type {};
+template<> struct is_word_key<uint64_t> : std::true_type {};
+template<> struct is_word_key<unsigned __int128> : std::true_type {};
+
+// Half of physical memory, which is what we're willing to spend on a hash table.
+inline size_t default_duplicate_memory_budget()
+{
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (pages <= 0 || page_size <= 0) {
+        return size_t(1) << 30;
+    }
+    return size_t(pages) * size_t(page_size) / 2;
+}
+
+namespace duplicate_finder_detail {
+    inline uint64_t mix(uint64_t x) {
+        // The splitmix64 finalizer.
+        x ^= x >> 30; x *= 0xbf58476d1ce4e5b9uLL;
+        x ^= x >> 27; x *= 0x94d049bb133111ebuLL;
+        x ^= x >> 31;
+        return x;
+    }
+    inline uint64_t mix(unsigned __int128 x) {
+        return mix(uint64_t(x) ^ mix(uint64_t(x >> 64)));
+    }
+
+    inline size_t hash_set_capacity(unsigned long long count) {
+        size_t capacity = 16;
+        while (capacity < count + count / 2) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    // LSD radix sort of keys[0..n), a byte at a time, skipping any byte
+    // that all the keys share. "scratch" must have room for n keys too.
+    template<class Key>
+    void radix_sort(Key *keys, Key *scratch, size_t n) {
+        Key *from = keys;
+        Key *to = scratch;
+        for (int shift = 0; n != 0 && shift < int(8 * sizeof(Key)); shift += 8) {
+            size_t counts[256] = {};
+            for (size_t i = 0; i < n; ++i) {
+                counts[uint8_t(from[i] >> shift)] += 1;
+            }
+            if (counts[uint8_t(from[0] >> shift)] == n) {
+                continue;
+            }
+            size_t sum = 0;
+            for (size_t& c : counts) {
+                size_t here = c;
+                c = sum;
+                sum += here;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                to[counts[uint8_t(from[i] >> shift)]++] = from[i];
+            }
+            std::swap(from, to);
+        }
+        if (from != keys) {
+            std::copy(from, from + n, keys);
+        }
+    }
+
+    // Call f(w) on threads w = 0 through num_threads-1, and wait for them all.
+    template<class F>
+    void run_on_threads(int num_threads, const F& f) {
+        std::vector<std::thread> threads;
+        for (int w = 1; w < num_threads; ++w) {
+            threads.emplace_back(f, w);
+        }
+        f(0);
+        for (auto&& t : threads) {
+            t.join();
+        }
+    }
+
+    // Merge the sorted runs [begin[r], begin[r+1]) of keys; return true
+    // and set *dup if two keys anywhere are equal.
+    template<class Key>
+    bool merge_runs_for_duplicate(const Key *keys, const std::vector<size_t>& begin, Key *dup) {
+        struct Head {
+            Key key;     // the smallest key left in a run
+            size_t pos;  // where it is
+            size_t end;  // where the run ends
+        };
+        auto greater = [](const Head& a, const Head& b) { return b.key < a.key; };
+        std::priority_queue<Head, std::vector<Head>, decltype(greater)> heads(greater);
+        for (size_t r = 0; r + 1 < begin.size(); ++r) {
+            if (begin[r] != begin[r+1]) {
+                heads.push(Head{keys[begin[r]], begin[r], begin[r+1]});
+            }
+        }
+        bool have_previous = false;
+        Key previous = 0;
+        while (!heads.empty()) {
+            Head h = heads.top();
+            heads.pop();
+            if (have_previous && h.key == previous) {
+                *dup = h.key;
+                return true;
+            }
+            previous = h.key;
+            have_previous = true;
+            if (h.pos + 1 < h.end) {
+                heads.push(Head{keys[h.pos + 1], h.pos + 1, h.end});
+            }
+        }
+        return false;
+    }
+} // namespace duplicate_finder_detail
+
+template<class Key, class Generate>
+bool find_duplicate_with_map(unsigned long long count, const Generate& generate, Key *dup)
+{
+    std::set<Key> seen;
+    bool found = false;
+    generate(0, count, [&](const Key& k) {
+        if (!seen.insert(k).second) {
+            *dup = k;
+            found = true;
+        }
+        return !found;
+    });
+    return found;
+}
+
+template<class Key, class Generate>
+bool find_duplicate_with_hash_set(unsigned long long count, const Generate& generate, Key *dup)
+{
+    // Zero marks an empty slot, so we keep track of the zero key separately.
+    const size_t capacity = duplicate_finder_detail::hash_set_capacity(count);
+    const size_t mask = capacity - 1;
+    std::unique_ptr<Key[]> slots(new Key[capacity]());
+    bool seen_zero = false;
+    bool found = false;
+    generate(0, count, [&](const Key& k) {
+        if (k == 0) {
+            found = seen_zero;
+            seen_zero = true;
+        } else {
+            for (size_t i = duplicate_finder_detail::mix(k) & mask; true; i = (i + 1) & mask) {
+                if (slots[i] == 0) {
+                    slots[i] = k;
+                    break;
+                } else if (slots[i] == k) {
+                    found = true;
+                    break;
+                }
+            }
+        }
+        if (found) {
+            *dup = k;
+        }
+        return !found;
+    });
+    return found;
+}
+
+template<class Key, class Generate>
+bool find_duplicate_with_sort(unsigned long long count, size_t memory_budget, int num_threads, const Generate& generate, Key *dup)
+{
+    using namespace duplicate_finder_detail;
+    // Several shards per thread, so that a thread with easy shards can pick up the slack.
+    const size_t num_shards = (num_threads == 1) ? 1 : std::min<unsigned long long>(4 * num_threads, count);
+    auto shard_begin = [&](size_t s) -> unsigned long long {
+        return (unsigned __int128)count * s / num_shards;
+    };
+    std::atomic<size_t> next_shard(0);
+
+    if (count * sizeof(Key) * 2 <= memory_budget) {
+        // Every shard becomes a sorted run in "keys"; then we merge them.
+        std::unique_ptr<Key[]> keys(new Key[count]);
+        std::unique_ptr<Key[]> scratch(new Key[count]);
+        run_on_threads(num_threads, [&](int) {
+            for (size_t s; (s = next_shard++) < num_shards; ) {
+                Key *out = &keys[shard_begin(s)];
+                generate(shard_begin(s), shard_begin(s+1), [&](const Key& k) { *out++ = k; return true; });
+                radix_sort(&keys[shard_begin(s)], &scratch[shard_begin(s)], shard_begin(s+1) - shard_begin(s));
+            }
+        });
+        scratch.reset();
+        std::vector<size_t> begin(num_shards + 1);
+        for (size_t s = 0; s <= num_shards; ++s) {
+            begin[s] = shard_begin(s);
+        }
+        return merge_runs_for_duplicate(keys.get(), begin, dup);
+    }
+
+    // Too big for memory: bucket the results by hash into temporary files,
+    // so that equal results land in the same bucket. Each thread will sort a
+    // whole bucket at a time, which takes twice the bucket's size.
+    int bits = 0;
+    while (bits < 9 && (count >> bits) * sizeof(Key) * 2 * num_threads > memory_budget) {
+        ++bits;
+    }
+    struct Bucket {
+        FILE *fp;
+        std::mutex mtx;
+    };
+    std::vector<Bucket> buckets(size_t(1) << bits);
+    for (Bucket& b : buckets) {
+        b.fp = tmpfile();
+        if (b.fp == nullptr) {
+            perror("tmpfile");
+            abort();
+        }
+    }
+    run_on_threads(num_threads, [&](int) {
+        // Each thread buffers its own writes to each bucket.
+        const size_t kBuffered = 1024;
+        std::vector<std::vector<Key>> pending(buckets.size());
+        auto flush = [&](size_t b) {
+            std::lock_guard<std::mutex> lk(buckets[b].mtx);
+            fwrite(pending[b].data(), sizeof(Key), pending[b].size(), buckets[b].fp);
+            pending[b].clear();
+        };
+        for (size_t s; (s = next_shard++) < num_shards; ) {
+            generate(shard_begin(s), shard_begin(s+1), [&](const Key& k) {
+                size_t b = (bits == 0) ? 0 : (mix(k) >> (64 - bits));
+                pending[b].push_back(k);
+                if (pending[b].size() == kBuffered) {
+                    flush(b);
+                }
+                return true;
+            });
+        }
+        for (size_t b = 0; b < buckets.size(); ++b) {
+            flush(b);
+        }
+    });
+    std::atomic<size_t> next_bucket(0);
+    std::atomic<bool> found(false);
+    std::mutex dup_mtx;
+    run_on_threads(num_threads, [&](int) {
+        std::vector<Key> keys, scratch;
+        for (size_t b; !found && (b = next_bucket++) < buckets.size(); ) {
+            FILE *fp = buckets[b].fp;
+            keys.resize(size_t(ftell(fp)) / sizeof(Key));
+            scratch.resize(keys.size());
+            rewind(fp);
+            if (fread(keys.data(), sizeof(Key), keys.size(), fp) != keys.size()) {
+                perror("fread");
+                abort();
+            }
+            radix_sort(keys.data(), scratch.data(), keys.size());
+            auto it = std::adjacent_find(keys.begin(), keys.end());
+            if (it != keys.end()) {
+                std::lock_guard<std::mutex> lk(dup_mtx);
+                *dup = *it;
+                found = true;
+            }
+        }
+    });
+    for (Bucket& b : buckets) {
+        fclose(b.fp);
+    }
+    return found;
+}
+
+// The engine to use for "count" results of type Key, given how much memory
+// we may spend and how many threads we have.
+template<class Key>
+DuplicateEngine choose_duplicate_engine(unsigned long long count, size_t memory_budget, int num_threads)
+{
+    if (!is_word_key<Key>::value || count < 1000) {
+        return DuplicateEngine::Map;
+    } else if (num_threads == 1 && duplicate_finder_detail::hash_set_capacity(count) * sizeof(Key) <= memory_budget) {
+        return DuplicateEngine::HashSet;
+    } else {
+        return DuplicateEngine::Sort;
+    }
+}
+
+template<class Key, class Generate>
+bool find_duplicate(DuplicateEngine engine, unsigned long long count, size_t memory_budget, int num_threads,
+                    const Generate& generate, Key *dup, std::true_type /* is_word_key */)
+{
+    switch (engine) {
+        case DuplicateEngine::Automatic: break;
+        case DuplicateEngine::Map: return find_duplicate_with_map(count, generate, dup);
+        case DuplicateEngine::HashSet: return find_duplicate_with_hash_set(count, generate, dup);
+        case DuplicateEngine::Sort: return find_duplicate_with_sort(count, memory_budget, num_threads, generate, dup);
+    }
+    assert(!"choose_duplicate_engine first");
+    return false;
+}
+
+template<class Key, class Generate>
+bool find_duplicate(DuplicateEngine, unsigned long long count, size_t, int, const Generate& generate, Key *dup, std::false_type)
+{
+    return find_duplicate_with_map(count, generate, dup);
+}
+
+// Look for two equal results among the "count" that generate() produces.
+// Keys that aren't plain words always go through the Map engine.
+template<class Key, class Generate>
+bool find_duplicate(DuplicateEngine engine, unsigned long long count, size_t memory_budget, int num_threads,
+                    const Generate& generate, Key *dup)
+{
+    return find_duplicate(engine, count, memory_budget, num_threads, generate, dup, is_word_key<Key>());
+}
+
+// The ranks of the first two results (or fewer, if there aren't two) that
+// equal "key", with the same generate() as find_duplicate.
+template<class Key, class Generate>
+std::vector<unsigned long long> find_ranks_of(const Key& key, unsigned long long count, int num_threads, const Generate& generate)
+{
+    std::vector<std::vector<unsigned long long>> found(num_threads);
+    duplicate_finder_detail::run_on_threads(num_threads, [&](int w) {
+        unsigned long long begin = (unsigned __int128)count * w / num_threads;
+        unsigned long long end = (unsigned __int128)count * (w + 1) / num_threads;
+        unsigned long long rank = begin;
+        generate(begin, end, [&](const Key& k) {
+            if (k == key) {
+                found[w].push_back(rank);
+            }
+            rank += 1;
+            return found[w].size() < 2;
+        });
+    });
+    std::vector<unsigned long long> ranks;
+    for (auto&& v : found) {
+        ranks.insert(ranks.end(), v.begin(), v.end());
+    }
+    ranks.resize(std::min<size_t>(ranks.size(), 2));
+    return ranks;
+}
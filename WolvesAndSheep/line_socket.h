@@ -0,0 +1,141 @@
+#pragma once
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Just enough sockets for ./mt to farm out work as lines of text.
+// An address is either "unix:/some/path" or "host:port"; a listening
+// address may leave out the host, as in ":7777", to listen on all of them.
+// Everything returns -1 (or false) on failure, with errno set.
+
+namespace line_socket_detail {
+    template<class F>
+    static int with_address(const std::string& address, bool passive, const F& f) {
+        if (address.compare(0, 5, "unix:") == 0) {
+            sockaddr_un sun = {};
+            sun.sun_family = AF_UNIX;
+            std::string path = address.substr(5);
+            if (path.empty() || path.size() >= sizeof sun.sun_path) {
+                errno = ENAMETOOLONG;
+                return -1;
+            }
+            memcpy(sun.sun_path, path.c_str(), path.size() + 1);
+            if (passive) {
+                unlink(path.c_str());  // a stale socket from a previous run
+            }
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd >= 0 && !f(fd, (const sockaddr*)&sun, socklen_t(sizeof sun))) {
+                close(fd);
+                fd = -1;
+            }
+            return fd;
+        }
+        size_t colon = address.rfind(':');
+        if (colon == std::string::npos) {
+            errno = EINVAL;
+            return -1;
+        }
+        std::string host = address.substr(0, colon);
+        std::string port = address.substr(colon + 1);
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = passive ? AI_PASSIVE : 0;
+        addrinfo *res = nullptr;
+        if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &res) != 0) {
+            errno = EHOSTUNREACH;
+            return -1;
+        }
+        int fd = -1;
+        for (addrinfo *ai = res; ai != nullptr && fd < 0; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd >= 0 && !f(fd, ai->ai_addr, ai->ai_addrlen)) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(res);
+        return fd;
+    }
+} // namespace line_socket_detail
+
+inline int listen_on(const std::string& address)
+{
+    return line_socket_detail::with_address(address, true, [](int fd, const sockaddr *sa, socklen_t len) {
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+        return bind(fd, sa, len) == 0 && listen(fd, 64) == 0;
+    });
+}
+
+inline int connect_to(const std::string& address)
+{
+    return line_socket_detail::with_address(address, false, [](int fd, const sockaddr *sa, socklen_t len) {
+        return connect(fd, sa, len) == 0;
+    });
+}
+
+inline bool send_line(int fd, const std::string& line)
+{
+    std::string msg = line + "\n";
+    size_t sent = 0;
+    while (sent < msg.size()) {
+        ssize_t r = send(fd, msg.data() + sent, msg.size() - sent, MSG_NOSIGNAL);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        } else if (r <= 0) {
+            return false;
+        }
+        sent += r;
+    }
+    return true;
+}
+
+// Reads newline-terminated lines from a socket, buffering whatever
+// comes after the end of the current line.
+class LineReader {
+public:
+    enum Status { Line, Timeout, Closed };
+
+    explicit LineReader(int fd) : fd_(fd) {}
+
+    // Wait up to timeout_ms (or forever, if it's negative) for a whole line.
+    Status read_line(std::string& line, int timeout_ms = -1) {
+        while (true) {
+            size_t nl = buf_.find('\n');
+            if (nl != std::string::npos) {
+                line = buf_.substr(0, nl);
+                buf_.erase(0, nl + 1);
+                return Line;
+            }
+            pollfd pfd = { fd_, POLLIN, 0 };
+            int r = poll(&pfd, 1, timeout_ms);
+            if (r < 0 && errno == EINTR) {
+                continue;
+            } else if (r == 0) {
+                return Timeout;
+            } else if (r < 0) {
+                return Closed;
+            }
+            char chunk[4096];
+            ssize_t got = recv(fd_, chunk, sizeof chunk, 0);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            } else if (got <= 0) {
+                return Closed;
+            }
+            buf_.append(chunk, got);
+        }
+    }
+
+private:
+    int fd_;
+    std::string buf_;
+};
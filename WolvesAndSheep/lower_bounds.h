@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Lower bounds on how many more tests a position needs, beyond the two that
+// attempt_testing has always applied (pigeonhole on the untested animals, and
+// "no class of indistinguishable candidates may outgrow 2^(remaining tests)").
+//
+// A new bound goes here as a class that's set up once per (n,k), plus a
+// PruneReason (see wolves.h) so that we can count how often it fires.
+
+// t(n,k) for the rows of the triangle we've already solved, i.e. the ones
+// ./st can precompute. Row n has n+1 entries, for k = 0 through n.
+static const std::vector<std::vector<int>>& known_triangle_rows()
+{
+    static const std::vector<std::vector<int>> rows = {
+        {0},
+        {0, 0},
+        {0, 1, 0},
+        {0, 2, 2, 0},
+        {0, 2, 3, 3, 0},
+        {0, 3, 4, 4, 4, 0},
+        {0, 3, 5, 5, 5, 5, 0},
+        {0, 3, 6, 6, 6, 6, 6, 0},
+        {0, 3, 6, 7, 7, 7, 7, 7, 0},
+        {0, 4, 7, 8, 8, 8, 8, 8, 8, 0},
+        {0, 4, 7, 9, 9, 9, 9, 9, 9, 9, 0},
+        {0, 4, 8,10,10,10,10,10,10,10,10, 0},
+        {0, 4, 8,11,11,11,11,11,11,11,11,11, 0},
+        {0, 4, 8,12,12,12,12,12,12,12,12,12,12, 0},
+    };
+    return rows;
+}
+
+// Sheep that have been in exactly the same tests so far are "twins": nothing
+// we've done yet tells them apart. Because we introduce animals in order and
+// keep twins' columns decreasing to the right, every group of twins is a
+// contiguous range of sheep.
+//
+// Suppose there's a group of g twins, and put j of the k wolves among them
+// and the other k-j anywhere else (which needs k-j <= n-g). All C(g,j)
+// such arrangements look alike so far; and a future test that involves any
+// of the k-j outside wolves comes back wolfy for all of them. So the remaining
+// tests, restricted to the group, must solve the (g,j) problem on their own:
+// we need at least t(g,j) more tests. The class-size check already enforces
+// ceil(lg C(g,j)); this bound wins whenever t(g,j) is bigger than that.
+//
+class TwinGroupBound {
+public:
+    explicit TwinGroupBound(int n, int k) {
+        // need[g][j] is a lower bound on t(g,j).
+        const auto& known = known_triangle_rows();
+        std::vector<std::vector<int>> need(n + 1);
+        for (int g = 0; g <= n; ++g) {
+            need[g].assign(g + 1, 0);
+            for (int j = 1; j < g; ++j) {
+                int b = ceil_lg_choose(g, j);
+                if (j == g - 1) {
+                    b = std::max(b, g - 1);  // finding the one sheep among g-1 wolves
+                }
+                if (j < g - 1) {
+                    b = std::max(b, need[g-1][j]);  // pretend one sheep is known to be a sheep
+                }
+                if (j >= 2) {
+                    b = std::max(b, need[g-1][j-1] + 1);  // ...or known to be a wolf
+                }
+                if (g < int(known.size())) {
+                    b = std::max(b, known[g][j]);
+                }
+                need[g][j] = b;
+            }
+        }
+        // Any subset of a group of twins is a group of twins too, so the
+        // bound for a group of g is the best bound for any g' <= g.
+        std::vector<int> group_needs(n + 1, 0);
+        for (int g = 1; g <= n; ++g) {
+            group_needs[g] = group_needs[g-1];
+            for (int j = std::max(0, k - (n - g)); j <= std::min(k, g); ++j) {
+                group_needs[g] = std::max(group_needs[g], need[g][j]);
+            }
+        }
+        largest_feasible_group_.assign(n + 1, 0);
+        for (int r = 0; r <= n; ++r) {
+            int g = 0;
+            while (g < n && group_needs[g+1] <= r) {
+                ++g;
+            }
+            largest_feasible_group_[r] = g;
+        }
+    }
+
+    // The biggest group of twins that "remaining" more tests could possibly sort out.
+    int largest_feasible_group(int remaining) const {
+        return largest_feasible_group_[std::min(remaining, int(largest_feasible_group_.size()) - 1)];
+    }
+
+private:
+    static int ceil_lg_choose(int g, int j) {
+        // lg C(g,j), computed as a sum of logs so that it can't overflow.
+        double lg = 0;
+        for (int i = 0; i < j; ++i) {
+            lg += std::log2(double(g - i)) - std::log2(double(i + 1));
+        }
+        return int(std::ceil(lg - 1e-9));
+    }
+
+    std::vector<int> largest_feasible_group_;
+};
@@ -0,0 +1,45 @@
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include "wolves.h"
+
+// Micro-benchmarks for the overhead around a search, rather than the search itself:
+// how long it takes to get an answer back out of solve_wolves when the answer
+// is trivial, when the search is cancelled almost immediately (as happens
+// constantly in ./mt), and when a small search fails or succeeds.
+
+template<class F>
+static void benchmark(const char *name, int iterations, const F& f)
+{
+    auto start = std::chrono::steady_clock::now();
+    int successes = 0;
+    for (int i = 0; i < iterations; ++i) {
+        NktResult result = f();
+        successes += result.success();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    printf("%-40s %10.0f ns/call  (%d of %d succeeded)\n", name, ns, successes, iterations);
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = (argc == 2) ? atoi(argv[1]) : 10000;
+
+    benchmark("trivial: n=10 k=3 t=5", iterations, []() {
+        return solve_wolves(10, 3, 5);
+    });
+    benchmark("cancelled after 1 node: n=12 k=3 t=10", iterations, []() {
+        return solve_wolves(12, 3, 10, []() { return true; });
+    });
+    benchmark("cancelled after 100 nodes: n=12 k=3 t=10", iterations, []() {
+        int polls = 0;
+        return solve_wolves(12, 3, 10, [&]() { return ++polls > 100; });
+    });
+    benchmark("exhausted: n=7 k=2 t=5", iterations, []() {
+        return solve_wolves(7, 2, 5, []() { return false; });
+    });
+    benchmark("solved: n=8 k=2 t=6", iterations / 10, []() {
+        return solve_wolves(8, 2, 6, []() { return false; });
+    });
+}
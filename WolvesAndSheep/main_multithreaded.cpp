@@ -1,28 +1,73 @@
 
+#include <algorithm>
 #include <assert.h>
 #include <atomic>
+#include <chrono>
+#include <cmath>
 #include <condition_variable>
+#include <deque>
+#include <errno.h>
+#include <limits.h>
+#include <memory>
 #include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <thread>
+#include <tuple>
 #include <vector>
 #include "eytzinger_utils.h"
+#include "line_socket.h"
+#include "mpsc_queue.h"
+#include "triangle_journal.h"
 #include "wolves.h"
 
+// Workers never do I/O or wait on each other to report what they've done.
+// They push events onto g_events, which never blocks; then event_thread
+// (the only consumer) writes the messages, and applies the results to the
+// Triangle, the journal, and our output.
+struct Event {
+    std::string message;                // if non-empty, write this to stderr
+    std::unique_ptr<NktResult> result;  // if non-null, the outcome of a search
+    double seconds = 0;                 // ...which took this long
+};
+static MpscQueue<Event> g_events;
+
 static void log_message(const char *fmt, ...)
 {
-    static std::mutex m;
-    std::lock_guard<std::mutex> lk(m);
     va_list ap;
     va_start(ap, fmt);
-    vfprintf(stderr, fmt, ap);
+    char buffer[200];
+    int len = vsnprintf(buffer, sizeof buffer, fmt, ap);
     va_end(ap);
+    Event e;
+    if (len < int(sizeof buffer)) {
+        e.message = buffer;
+    } else {
+        e.message.resize(len + 1);
+        va_start(ap, fmt);
+        vsnprintf(&e.message[0], e.message.size(), fmt, ap);
+        va_end(ap);
+        e.message.resize(len);
+    }
+    g_events.push(std::move(e));
 }
 
+// How the triangle steers a search in progress: it can tell the worker to
+// give up, or to carry on looking for a shorter solution than it set out to.
+struct Assignment {
+    std::atomic<bool> stop{false};
+    std::atomic<int> target_t{0};
+};
+
 struct WorkItem {
-    std::atomic<bool> *stop_working = nullptr;
+    // Shared with the worker, so that it stays valid until the
+    // event thread has applied the worker's result.
+    std::shared_ptr<Assignment> assignment;
     int min_t = 0;
     int max_t = INT_MAX;
     int worker_t = 0;
@@ -33,11 +78,11 @@ struct WorkItem {
     }
 
     bool is_unstarted() const {
-        return (min_t != max_t) && (stop_working == nullptr);
+        return (min_t != max_t) && (assignment == nullptr);
     }
 
     bool is_in_progress() const {
-        return stop_working != nullptr;
+        return assignment != nullptr;
     }
 
     bool has_answer() const {
@@ -45,20 +90,113 @@ struct WorkItem {
     }
 
     void maybe_interrupt_worker() {
-        if (stop_working == nullptr) {
+        if (assignment == nullptr) {
             // nobody is currently working on this problem
         } else if (min_t <= worker_t && worker_t < max_t) {
             // the active task will still teach us something
+        } else if (min_t < max_t && max_t <= worker_t) {
+            // Somebody else found a solution in max_t tests. What we've
+            // searched so far is good for max_t-1 too; keep going with that.
+            worker_t = max_t - 1;
+            assignment->target_t.store(worker_t);
         } else {
-            stop_working->store(true);
+            assignment->stop.store(true);
         }
     }
 };
 
+// Predicts how long solve_wolves(n,k,t) will take, by fitting
+//     log(seconds) = a + b*n + c*t + d*lg(C(n,k))
+// to the searches we've seen finish. Until we have much history, the fit
+// is pulled toward a rough prior (each extra sheep costs a factor of e).
+class CostModel {
+    static constexpr int F = 4;
+    double xtx_[F][F] = {};
+    double xty_[F] = {};
+    double beta_[F] = {};
+
+    static void features(int n, int k, int t, double *x) {
+        x[0] = 1;
+        x[1] = n;
+        x[2] = t;
+        x[3] = (std::lgamma(n + 1.0) - std::lgamma(k + 1.0) - std::lgamma(n - k + 1.0)) / std::log(2.0);
+    }
+
+    void refit() {
+        static constexpr double prior[F] = { -12, 1, 0, 0 };
+        static constexpr double lambda = 1.0;
+        double a[F][F + 1];
+        for (int i = 0; i < F; ++i) {
+            for (int j = 0; j < F; ++j) {
+                a[i][j] = xtx_[i][j] + (i == j ? lambda : 0);
+            }
+            a[i][F] = xty_[i] + lambda * prior[i];
+        }
+        // Gaussian elimination; the matrix is positive definite, so no pivoting.
+        for (int i = 0; i < F; ++i) {
+            for (int r = i + 1; r < F; ++r) {
+                double f = a[r][i] / a[i][i];
+                for (int c = i; c <= F; ++c) {
+                    a[r][c] -= f * a[i][c];
+                }
+            }
+        }
+        for (int i = F; i-- != 0; ) {
+            double v = a[i][F];
+            for (int c = i + 1; c < F; ++c) {
+                v -= a[i][c] * beta_[c];
+            }
+            beta_[i] = v / a[i][i];
+        }
+    }
+
+public:
+    CostModel() { refit(); }
+
+    // solve_wolves answers these without searching (e.g. by information theory).
+    static bool is_trivial(int n, int k, int t) {
+        double x[F];
+        features(n, k, t, x);
+        return (k <= 1 || k >= n-1 || t >= n-1 || x[3] > t);
+    }
+
+    void record(int n, int k, int t, double seconds) {
+        if (is_trivial(n, k, t)) {
+            return;  // it tells us nothing about how long a search takes
+        }
+        double x[F];
+        features(n, k, t, x);
+        double y = std::log(std::max(seconds, 1e-4));
+        for (int i = 0; i < F; ++i) {
+            for (int j = 0; j < F; ++j) {
+                xtx_[i][j] += x[i] * x[j];
+            }
+            xty_[i] += x[i] * y;
+        }
+        refit();
+    }
+
+    double estimate_seconds(int n, int k, int t) const {
+        if (is_trivial(n, k, t)) {
+            return 1e-4;
+        }
+        double x[F];
+        features(n, k, t, x);
+        double y = 0;
+        for (int i = 0; i < F; ++i) {
+            y += beta_[i] * x[i];
+        }
+        return std::exp(std::min(y, 50.0));
+    }
+};
+
+using Grid = std::vector<std::vector<WorkItem>>;
+
 struct Triangle {
     std::mutex mtx;
-    std::condition_variable cv;
-    std::vector<std::vector<WorkItem>> entries;
+    Grid entries;
+    CostModel costs;
+    TriangleJournal journal;  // if open, where the event thread records each search's outcome
 
     explicit Triangle(int n) {
         static constexpr int X = -1;
@@ -109,6 +247,10 @@ struct Triangle {
     }
 
     void update_mins_and_maxes(int n, int k) {
+        update_mins_and_maxes(entries, n, k);
+    }
+
+    static void update_mins_and_maxes(Grid& entries, int n, int k) {
         if (k == 0 || k == n) {
             // The answer is "0" and we learn nothing from this.
             return;
@@ -158,7 +300,7 @@ struct Triangle {
                 assert(k2 < entries[n2].size());
                 if (entries[n2][k2].min_t < new_min) {
                     entries[n2][k2].min_t = new_min;
-                    update_mins_and_maxes(n2, k2);
+                    update_mins_and_maxes(entries, n2, k2);
                     entries[n2][k2].maybe_interrupt_worker();
                 }
             }
@@ -181,145 +323,680 @@ struct Triangle {
         }
     }
 
-    std::tuple<int, int, int> get_work(std::atomic<bool> *stop_working) {
-        auto assign = [&](int n, int k) {
-            assert(entries[n][k].stop_working == nullptr);
-            entries[n][k].stop_working = stop_working;
-            entries[n][k].worker_t = (entries[n][k].min_t + entries[n][k].max_t) / 2;
-            log_message("Working on n=%d, k=%d, t=%d (min=%d max=%d)\n", n, k, entries[n][k].worker_t, entries[n][k].min_t, entries[n][k].max_t);
-            return std::make_tuple(n, k, entries[n][k].worker_t);
-        };
-        std::unique_lock<std::mutex> lk(mtx);
-        for (int n=0; n < entries.size(); ++n) {
-            assert(entries[n].size() == n+1);
-            // Assign work from the middle of a row: k == n/2 is easier.
-            if (entries[n][1].is_unstarted()) {
-                return assign(n, 1);
+    // How far apart min_t and max_t are; no search needs more than n-1 tests.
+    static int width(const Grid& grid, int n, int k) {
+        return std::max(std::min(grid[n][k].max_t, n-1) - grid[n][k].min_t, 0);
+    }
+
+    // Pretend we've just learned that t(n,k) <= t (if success) or t(n,k) > t
+    // (if not), and propagate that through a copy of the triangle. Return how
+    // much all the [min_t, max_t] intervals shrank in total, and mark the
+    // entries that changed.
+    int narrowing(int n, int k, int t, bool success, std::vector<std::vector<bool>> *changed) const {
+        Grid scratch = entries;
+        for (auto&& row : scratch) {
+            for (auto&& e : row) {
+                e.assignment = nullptr;  // don't interrupt anybody for real
             }
-            int workers_already_in_this_row = 0;
-            for (int k=0; k < n; ++k) {
+        }
+        if (success) {
+            scratch[n][k].max_t = std::min(scratch[n][k].max_t, t);
+        } else {
+            scratch[n][k].min_t = std::max(scratch[n][k].min_t, t+1);
+        }
+        update_mins_and_maxes(scratch, n, k);
+        int total = 0;
+        for (int n2 = 0; n2 < int(entries.size()); ++n2) {
+            for (int k2 = 0; k2 <= n2; ++k2) {
+                int shrinkage = width(entries, n2, k2) - width(scratch, n2, k2);
+                total += shrinkage;
+                if (changed != nullptr && shrinkage != 0) {
+                    (*changed)[n2][k2] = true;
+                }
+            }
+        }
+        return total;
+    }
+
+    // Pick the unstarted (n,k,t) with the most expected narrowing of the
+    // triangle per estimated second of searching. If t(n,k) is equally likely
+    // to be anything from min_t to max_t, then searching for t succeeds with
+    // probability (t - min_t + 1) / (max_t - min_t + 1). Entries that some
+    // search already in progress might settle are worth much less, because
+    // we'll probably be interrupted. Ties go to the entry earlier in row order
+    // (and in Eytzinger order within a row, so that we start from the middle).
+    std::tuple<int, int, int> get_work(const std::shared_ptr<Assignment>& assignment) {
+        static constexpr double kContendedDiscount = 0.25;
+        std::unique_lock<std::mutex> lk(mtx);
+        std::vector<std::vector<bool>> contended;
+        for (int n=0; n < int(entries.size()); ++n) {
+            contended.emplace_back(n+1, false);
+        }
+        for (int n=0; n < int(entries.size()); ++n) {
+            for (int k=0; k <= n; ++k) {
                 if (entries[n][k].is_in_progress()) {
-                    workers_already_in_this_row += 1;
+                    narrowing(n, k, entries[n][k].worker_t, true, &contended);
+                    narrowing(n, k, entries[n][k].worker_t, false, &contended);
                 }
             }
-            if (workers_already_in_this_row <= 1) {
-                // Avoid putting too many workers in a single row
-                // of the triangle, because they'll be constantly
-                // interrupting each other.
-                for (int i=0; i < n; ++i) {
-                    int k = eytzinger_from_rank(i, n);
-                    assert(0 <= k && k < n);
-                    if (entries[n][k].is_unstarted()) {
-                        return assign(n, k);
+        }
+        int best_n = -1, best_k = -1, best_t = -1;
+        double best_score = 0, best_value = 0, best_seconds = 0;
+        for (int n=0; n < int(entries.size()); ++n) {
+            assert(entries[n].size() == n+1);
+            for (int i=0; i < n; ++i) {
+                int k = eytzinger_from_rank(i, n);
+                assert(0 <= k && k < n);
+                const WorkItem& e = entries[n][k];
+                if (!e.is_unstarted()) {
+                    continue;
+                }
+                const int max_t = std::min(e.max_t, n-1);
+                for (int t = e.min_t; t < max_t; ++t) {
+                    double p = double(t - e.min_t + 1) / (max_t - e.min_t + 1);
+                    double value = p * narrowing(n, k, t, true, nullptr) + (1 - p) * narrowing(n, k, t, false, nullptr);
+                    if (contended[n][k]) {
+                        value *= kContendedDiscount;
+                    }
+                    double seconds = costs.estimate_seconds(n, k, t);
+                    double score = value / seconds;
+                    if (score > best_score) {
+                        best_n = n; best_k = k; best_t = t;
+                        best_score = score; best_value = value; best_seconds = seconds;
                     }
                 }
             }
         }
-        // We didn't find any work not-yet-being-done. Start a fresh row.
-        start_fresh_row();
-        lk.unlock();
-        return get_work(stop_working);
+        if (best_n < 0) {
+            // We didn't find any work not-yet-being-done. Start a fresh row.
+            start_fresh_row();
+            lk.unlock();
+            return get_work(assignment);
+        }
+        WorkItem& e = entries[best_n][best_k];
+        e.assignment = assignment;
+        e.worker_t = best_t;
+        assignment->target_t = best_t;
+        log_message("Working on n=%d, k=%d, t=%d (min=%d max=%d, value %.1f, about %.3gs)\n",
+                    best_n, best_k, best_t, e.min_t, e.max_t, best_value, best_seconds);
+        return std::make_tuple(best_n, best_k, best_t);
+    }
+
+    // Remember how long a search that ran to completion took.
+    void record_time(int n, int k, int t, double seconds) {
+        std::lock_guard<std::mutex> lk(mtx);
+        costs.record(n, k, t, seconds);
     }
 
     void report_early_terminate(int n, int k) {
         std::lock_guard<std::mutex> lk(mtx);
         assert(0 <= n && n < entries.size());
         assert(0 <= k && k <= entries[n].size());
-        entries[n][k].stop_working = nullptr;
+        entries[n][k].assignment = nullptr;
+    }
+
+    // A copy of everybody's bounds, so that we can print them without holding the lock.
+    struct Cell {
+        int min_t;
+        int max_t;
+        bool in_progress;
+    };
+    std::vector<std::vector<Cell>> snapshot() {
+        std::lock_guard<std::mutex> lk(mtx);
+        std::vector<std::vector<Cell>> cells(entries.size());
+        for (int n = 0; n < int(entries.size()); ++n) {
+            for (const WorkItem& e : entries[n]) {
+                cells[n].push_back(Cell{e.min_t, e.max_t, e.is_in_progress()});
+            }
+        }
+        return cells;
+    }
+
+    // Apply a fact from a journal (perhaps from some other run), growing the
+    // triangle if necessary. Return false if it contradicts what we know.
+    bool apply_journal_fact(bool is_upper, int n, int k, int t) {
+        std::lock_guard<std::mutex> lk(mtx);
+        while (int(entries.size()) <= n) {
+            start_fresh_row();
+        }
+        WorkItem& e = entries[n][k];
+        if (is_upper ? (t < e.min_t) : (t > e.max_t)) {
+            return false;
+        }
+        if (is_upper && t < e.max_t) {
+            e.max_t = t;
+            update_mins_and_maxes(n, k);
+        } else if (!is_upper && e.min_t < t) {
+            e.min_t = t;
+            update_mins_and_maxes(n, k);
+        }
+        return true;
     }
 
-    void report_positive_result(int n, int k, int t) {
+    void report_positive_result(const NktResult& result) {
+        const int n = result.n;
+        const int k = result.k;
+        const int t = result.t;
         std::lock_guard<std::mutex> lk(mtx);
         assert(0 <= n && n < entries.size());
         assert(0 <= k && k <= entries[n].size());
         assert(entries[n][k].min_t <= t);
         // It can be done in "t" steps, so the new maximum is "t".
-        entries[n][k].stop_working = nullptr;
+        entries[n][k].assignment = nullptr;
         if (t < entries[n][k].max_t) {
             entries[n][k].max_t = t;
             update_mins_and_maxes(n, k);
-            cv.notify_all();
         }
     }
 
-    void report_negative_result(int n, int k, int t) {
+    void report_negative_result(const NktResult& result) {
+        const int n = result.n;
+        const int k = result.k;
+        const int t = result.t;
         std::lock_guard<std::mutex> lk(mtx);
         assert(0 <= n && n < entries.size());
         assert(0 <= k && k <= entries[n].size());
         assert(t <= entries[n][k].max_t);
         // It can't be done in "t" steps, so the new minimum is "t+1".
-        entries[n][k].stop_working = nullptr;
+        entries[n][k].assignment = nullptr;
         if (entries[n][k].min_t < t+1) {
             entries[n][k].min_t = t+1;
             update_mins_and_maxes(n, k);
-            cv.notify_all();
         }
     }
 };
 
-static void worker_thread(Triangle& triangle)
+// The CPUs we're allowed to run on, in order.
+static std::vector<int> allowed_cpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof set, &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+// Pin the calling thread, which is worker w, to its own block of
+// cpus_per_worker consecutive CPUs (wrapping around if there aren't enough).
+// The search threads it starts inherit the same block. And since Linux puts a
+// page of memory on the NUMA node of whichever thread first touches it,
+// everything the worker allocates from here on -- in particular, the vectors
+// of candidates that each search builds -- stays on the worker's own node,
+// as long as the block doesn't straddle two nodes.
+static void pin_worker(const std::vector<int>& cpus, int w, int cpus_per_worker)
+{
+    if (cpus.empty()) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int i = 0; i < cpus_per_worker; ++i) {
+        CPU_SET(cpus[(size_t(w) * cpus_per_worker + i) % cpus.size()], &set);
+    }
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+    if (rc != 0) {
+        log_message("Failed to pin worker %d: %s\n", w, strerror(rc));
+    }
+}
+
+// Apply the outcome of a search, wherever it ran. Only event_thread calls this.
+static void apply_result(Triangle& triangle, const NktResult& result, double seconds)
+{
+    const int n = result.n;
+    const int k = result.k;
+    const int t = result.t;
+    if (result.status == NktStatus::Terminated) {
+        // We have been instructed to give up early.
+        return triangle.report_early_terminate(n, k);
+    }
+    triangle.record_time(n, k, t, seconds);
+    if (result.success()) {
+        fputs(nkt_result_message(result).c_str(), stderr);
+        triangle.journal.append_upper(result);
+        return triangle.report_positive_result(result);
+    } else {
+        triangle.journal.append_lower(n, k, t+1);
+        return triangle.report_negative_result(result);
+    }
+}
+
+// Hand the outcome of a search to the event thread.
+static void publish_result(const NktResult& result, double seconds)
+{
+    Event e;
+    e.result.reset(new NktResult(result));
+    e.seconds = seconds;
+    g_events.push(std::move(e));
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void worker_thread(Triangle& triangle, int search_threads)
 {
-    std::atomic<bool> stop_working(false);
-    std::tuple<int, int, int> nkt = triangle.get_work(&stop_working);
+    auto assignment = std::make_shared<Assignment>();
+    std::tuple<int, int, int> nkt = triangle.get_work(assignment);
     auto early_terminate = [&]() {
-        return stop_working.load();
+        return assignment->stop.load();
     };
     int n = std::get<0>(nkt);
     int k = std::get<1>(nkt);
     int t = std::get<2>(nkt);
-    try {
-        NktResult result = solve_wolves(n, k, t, early_terminate);
-        if (result.success) {
-            log_message("%s", result.message.c_str());
-            return triangle.report_positive_result(n, k, t);
-        } else {
-            return triangle.report_negative_result(n, k, t);
+    auto start = std::chrono::steady_clock::now();
+    NktResult result = solve_wolves(n, k, t, early_terminate, search_threads, &assignment->target_t);
+    publish_result(result, seconds_since(start));
+}
+
+// Worker processes elsewhere (see remote_worker_connection) can stand in
+// for worker_thread. Each connection gets one (n,k,t) at a time, and
+// we relay interrupts to it. The protocol is lines of text:
+//
+//     coordinator -> worker:  work ID n k t
+//                             target ID t     (look for at most t tests instead)
+//                             stop ID
+//     worker -> coordinator:  done ID STATUS n k t [tests]
+//
+// where STATUS is an nkt_status_name, and the tests of a solution
+// are written as in the journal (see triangle_journal.h). The t that
+// comes back may be lower than the one we sent out, because of "target".
+
+static std::string done_line(int id, const NktResult& result)
+{
+    std::string line = "done " + std::to_string(id) + " " + nkt_status_name(result.status) + " " +
+        std::to_string(result.n) + " " + std::to_string(result.k) + " " + std::to_string(result.t);
+    if (result.status == NktStatus::Found) {
+        for (int i = 0; i < result.num_tests; ++i) {
+            line += " " + test_as_hex(result, i);
         }
-    } catch (const EarlyTerminateException&) {
-        // We have been instructed to give up early.
-        return triangle.report_early_terminate(n, k);
     }
+    return line;
 }
 
-static void printer_thread(Triangle& triangle)
+static bool parse_done_line(const std::string& line, int id, int n, int k, int t, NktResult& result)
+{
+    char status[40];
+    int line_id, offset = 0;
+    if (sscanf(line.c_str(), "done %d %39s %d %d %d%n", &line_id, status, &result.n, &result.k, &result.t, &offset) != 5) {
+        return false;
+    }
+    if (line_id != id || result.n != n || result.k != k || result.t > t) {
+        return false;
+    }
+    bool known_status = false;
+    for (NktStatus s : { NktStatus::TooFewTestsForInformation, NktStatus::NoTestsNeeded, NktStatus::OneByOne,
+                         NktStatus::TooFewTestsForOneSheep, NktStatus::BinarySearch, NktStatus::Found,
+                         NktStatus::Exhausted, NktStatus::Terminated }) {
+        if (strcmp(status, nkt_status_name(s)) == 0) {
+            result.status = s;
+            known_status = true;
+        }
+    }
+    result.num_tests = 0;
+    const char *p = line.c_str() + offset;
+    char hex[80];
+    int len = 0;
+    while (sscanf(p, " %79s%n", hex, &len) == 1) {
+        if (result.num_tests == t || !test_from_hex(hex, result, result.num_tests)) {
+            return false;
+        }
+        result.num_tests += 1;
+        p += len;
+    }
+    return known_status;
+}
+
+static void remote_worker_session(Triangle& triangle, int fd)
+{
+    LineReader reader(fd);
+    for (int id = 1; true; ++id) {
+        auto assignment = std::make_shared<Assignment>();
+        std::tuple<int, int, int> nkt = triangle.get_work(assignment);
+        int n = std::get<0>(nkt);
+        int k = std::get<1>(nkt);
+        int t = std::get<2>(nkt);
+        auto start = std::chrono::steady_clock::now();
+        bool ok = send_line(fd, "work " + std::to_string(id) + " " + std::to_string(n) + " " + std::to_string(k) + " " + std::to_string(t));
+        bool stop_sent = false;
+        int target_sent = t;
+        bool done = false;
+        NktResult result;
+        std::string line;
+        while (ok && !done) {
+            // Check every so often whether we've been told to interrupt or retarget this search.
+            LineReader::Status status = reader.read_line(line, 100);
+            if (status == LineReader::Closed) {
+                ok = false;
+            } else if (status == LineReader::Line) {
+                done = parse_done_line(line, id, n, k, t, result);
+                if (!done) {
+                    log_message("Unexpected message from a remote worker: %s\n", line.c_str());
+                    ok = false;
+                }
+            } else if (!stop_sent && assignment->stop.load()) {
+                ok = send_line(fd, "stop " + std::to_string(id));
+                stop_sent = true;
+            } else if (!stop_sent && assignment->target_t.load() < target_sent) {
+                target_sent = assignment->target_t.load();
+                ok = send_line(fd, "target " + std::to_string(id) + " " + std::to_string(target_sent));
+            }
+        }
+        if (!done) {
+            log_message("Lost a remote worker; it was working on n=%d, k=%d, t=%d\n", n, k, t);
+            triangle.report_early_terminate(n, k);
+            close(fd);
+            return;
+        }
+        publish_result(result, seconds_since(start));
+    }
+}
+
+static void accept_remote_workers(Triangle& triangle, int listen_fd)
 {
-    int count = 0;
-    std::unique_lock<std::mutex> lk(triangle.mtx);
     while (true) {
-        printf("UPDATE %d!------------------------------\n", count);
-        for (int n = 0; n < triangle.entries.size(); ++n) {
-            printf("    n=%-2d ", n);
-            for (int k = 0; k < triangle.entries[n].size(); ++k) {
-                if (triangle.entries[n][k].has_answer()) {
-                    printf("%3d", triangle.entries[n][k].min_t);
-                } else if (triangle.entries[n][k].is_in_progress()) {
-                    printf("  x");
-                } else {
-                    printf("  .");
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno != EINTR) {
+                log_message("Failed to accept a remote worker: %s\n", strerror(errno));
+            }
+            continue;
+        }
+        std::thread([&triangle, fd]() {
+            remote_worker_session(triangle, fd);
+        }).detach();
+    }
+}
+
+// The other end of remote_worker_session: search whatever the coordinator
+// asks us to, until it hangs up.
+static void remote_worker_connection(const std::string& address, int search_threads)
+{
+    int fd = connect_to(address);
+    if (fd < 0) {
+        log_message("Failed to connect to %s: %s\n", address.c_str(), strerror(errno));
+        return;
+    }
+    struct RemoteAssignment {
+        int id, n, k, t;
+        Assignment steering;
+    };
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<std::shared_ptr<RemoteAssignment>> assignments;
+    std::shared_ptr<RemoteAssignment> latest;  // the one "stop" and "target" refer to
+    bool closed = false;
+    std::atomic<bool> hung_up(false);
+
+    std::thread listener([&]() {
+        LineReader reader(fd);
+        std::string line;
+        while (reader.read_line(line) == LineReader::Line) {
+            int id, n, k, t;
+            std::lock_guard<std::mutex> lk(mtx);
+            if (sscanf(line.c_str(), "work %d %d %d %d", &id, &n, &k, &t) == 4 && 0 <= k && k <= n && n <= kMaxSheep && t >= 0) {
+                latest = std::make_shared<RemoteAssignment>();
+                latest->id = id; latest->n = n; latest->k = k; latest->t = t;
+                latest->steering.target_t = t;
+                assignments.push_back(latest);
+                cv.notify_all();
+            } else if (sscanf(line.c_str(), "target %d %d", &id, &t) == 2) {
+                if (latest != nullptr && latest->id == id && t < latest->steering.target_t) {
+                    latest->steering.target_t = t;
+                }
+            } else if (sscanf(line.c_str(), "stop %d", &id) == 1) {
+                if (latest != nullptr && latest->id == id) {
+                    latest->steering.stop = true;
                 }
+            } else {
+                log_message("Unexpected message from %s: %s\n", address.c_str(), line.c_str());
             }
-            printf("\n");
         }
-        ++count;
-        triangle.cv.wait(lk);
+        hung_up = true;
+        std::lock_guard<std::mutex> lk(mtx);
+        closed = true;
+        cv.notify_all();
+    });
+
+    while (true) {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait(lk, [&]() { return closed || !assignments.empty(); });
+        if (assignments.empty()) {
+            break;
+        }
+        std::shared_ptr<RemoteAssignment> a = assignments.front();
+        assignments.pop_front();
+        lk.unlock();
+        log_message("Working on n=%d, k=%d, t=%d for %s\n", a->n, a->k, a->t, address.c_str());
+        auto early_terminate = [&]() { return a->steering.stop.load() || hung_up.load(); };
+        NktResult result = solve_wolves(a->n, a->k, a->t, early_terminate, search_threads, &a->steering.target_t);
+        if (!send_line(fd, done_line(a->id, result))) {
+            break;
+        }
+    }
+    shutdown(fd, SHUT_RDWR);
+    listener.join();
+    close(fd);
+}
+
+static void print_triangle(const std::vector<std::vector<Triangle::Cell>>& cells, int count)
+{
+    printf("UPDATE %d!------------------------------\n", count);
+    for (int n = 0; n < int(cells.size()); ++n) {
+        printf("    n=%-2d ", n);
+        for (const Triangle::Cell& c : cells[n]) {
+            if (c.min_t == c.max_t) {
+                printf("%3d", c.min_t);
+            } else if (c.in_progress) {
+                printf("  x");
+            } else {
+                printf("  .");
+            }
+        }
+        printf("\n");
+    }
+}
+
+// Print a line for each entry whose bounds changed since "shown", e.g.
+//     BOUNDS n=14 k=3 min=11 max=12
+// (where a max of -1 means we don't know one yet), and update "shown".
+static void print_changed_bounds(const std::vector<std::vector<Triangle::Cell>>& cells,
+                                 std::vector<std::vector<Triangle::Cell>>& shown)
+{
+    for (int n = 0; n < int(cells.size()); ++n) {
+        if (n == int(shown.size())) {
+            shown.emplace_back(n+1, Triangle::Cell{-1, -1, false});
+        }
+        for (int k = 0; k <= n; ++k) {
+            const Triangle::Cell& c = cells[n][k];
+            if (c.min_t != shown[n][k].min_t || c.max_t != shown[n][k].max_t) {
+                printf("BOUNDS n=%d k=%d min=%d max=%d\n", n, k, c.min_t, (c.max_t == INT_MAX) ? -1 : c.max_t);
+                shown[n][k] = c;
+            }
+        }
+    }
+}
+
+// Drain g_events until "stop" is set and there's nothing left. If there's
+// a triangle, apply results to it, print what changed as it changes, and
+// print the whole thing every snapshot_seconds.
+static void event_thread(Triangle *triangle, int snapshot_seconds, const std::atomic<bool>& stop)
+{
+    std::vector<std::vector<Triangle::Cell>> shown;
+    int count = 0;
+    auto next_snapshot = std::chrono::steady_clock::now();
+    while (true) {
+        bool changed = false;
+        Event e;
+        while (g_events.pop(e)) {
+            if (!e.message.empty()) {
+                fputs(e.message.c_str(), stderr);
+            }
+            if (e.result != nullptr && triangle != nullptr) {
+                apply_result(*triangle, *e.result, e.seconds);
+                changed = true;
+            }
+        }
+        const bool snapshot_due = (triangle != nullptr && std::chrono::steady_clock::now() >= next_snapshot);
+        if (changed || snapshot_due) {
+            auto cells = triangle->snapshot();
+            print_changed_bounds(cells, shown);
+            if (snapshot_due) {
+                print_triangle(cells, count++);
+                next_snapshot = std::chrono::steady_clock::now() + std::chrono::seconds(snapshot_seconds);
+            }
+            fflush(stdout);
+        } else if (stop.load()) {
+            break;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
     }
 }
 
 int main(int argc, char **argv)
 {
+    int num_threads = -1;
+    int search_threads = 1;
+    bool pin = false;
+    std::string checkpoint_dir;
+    int checkpoint_interval = 600;
+    bool resume = false;
+    std::string journal_file;
+    std::vector<std::string> merge_files;
+    std::string serve_address;
+    std::string connect_address;
+    int snapshot_interval = 60;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; ++i) {
+        if (strcmp(argv[i], "--transposition-table") == 0 && i+1 < argc) {
+            // All the workers share one table.
+            solve_wolves_use_transposition_table(size_t(atoi(argv[++i])) << 20);
+        } else if (strcmp(argv[i], "--threads") == 0 && i+1 < argc) {
+            // Run this many workers, each searching its own (n,k,t).
+            num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--pin") == 0) {
+            // Pin each worker (and its search threads) to its own CPUs.
+            pin = true;
+        } else if (strcmp(argv[i], "--search-threads") == 0 && i+1 < argc) {
+            // Each worker searches its (n,k,t) using this many threads.
+            search_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--checkpoint-dir") == 0 && i+1 < argc) {
+            // Each (n,k,t) search saves its progress here. With --resume, a search
+            // that was interrupted (by us, or by a crash) needn't start over.
+            checkpoint_dir = argv[++i];
+        } else if (strcmp(argv[i], "--checkpoint-interval") == 0 && i+1 < argc) {
+            checkpoint_interval = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--resume") == 0) {
+            resume = true;
+        } else if (strcmp(argv[i], "--stats") == 0 && i+1 < argc) {
+            // Every so often, log a line of statistics about each long-running search.
+            solve_wolves_report_stats(atoi(argv[++i]), [](const SearchStats& stats) {
+                log_message("%s", search_stats_line(stats).c_str());
+            });
+        } else if (strcmp(argv[i], "--journal") == 0 && i+1 < argc) {
+            // Start from everything this file knows, and record what we learn in it.
+            journal_file = argv[++i];
+        } else if (strcmp(argv[i], "--merge") == 0 && i+1 < argc) {
+            // Also start from everything this file knows (e.g. another run's journal).
+            merge_files.push_back(argv[++i]);
+        } else if (strcmp(argv[i], "--snapshot-interval") == 0 && i+1 < argc) {
+            // Print the whole triangle this often, besides each change as it happens.
+            snapshot_interval = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--serve") == 0 && i+1 < argc) {
+            // Hand out work to remote workers connecting to this address too.
+            serve_address = argv[++i];
+        } else if (strcmp(argv[i], "--connect") == 0 && i+1 < argc) {
+            // Be a remote worker for the coordinator at this address.
+            connect_address = argv[++i];
+        } else {
+            printf("Usage: ./mt [--threads N] [--pin] [--transposition-table MB] [--search-threads S]\n"
+                   "            [--checkpoint-dir DIR [--checkpoint-interval SECS] [--resume]]\n"
+                   "            [--stats SECS] [--snapshot-interval SECS] [--journal FILE] [--merge FILE]...\n"
+                   "            [--serve ADDRESS] [r]\n"
+                   "       ./mt [--threads N] [--pin] [--transposition-table MB] [--search-threads S] --connect ADDRESS\n"
+                   "N defaults to one worker per S CPUs; ADDRESS is host:port or unix:path.\n");
+            exit(1);
+        }
+    }
+    if (!checkpoint_dir.empty()) {
+        solve_wolves_use_checkpoints(checkpoint_dir, checkpoint_interval, resume);
+    }
+    search_threads = std::max(search_threads, 1);
+    if (num_threads < 0) {
+        num_threads = std::max(int(std::thread::hardware_concurrency()) / search_threads, 1);
+    }
+    const std::vector<int> cpus = pin ? allowed_cpus() : std::vector<int>();
+
+    std::atomic<bool> stop_events(false);
+    if (!connect_address.empty()) {
+        std::thread events(event_thread, nullptr, 0, std::cref(stop_events));
+        // Each thread has its own connection, and so gets its own work.
+        std::vector<std::thread> connections;
+        for (int i=0; i < std::max(num_threads, 1); ++i) {
+            connections.emplace_back([&, i]() {
+                pin_worker(cpus, i, search_threads);
+                remote_worker_connection(connect_address, search_threads);
+            });
+        }
+        for (auto&& th : connections) {
+            th.join();
+        }
+        stop_events = true;
+        events.join();
+        return 0;
+    }
     // Precompute n rows, to pick up where we left off.
-    int n = argc == 2 ? atoi(argv[1]) : 0;
+    int n = (i + 1 == argc) ? atoi(argv[i]) : 0;
     Triangle triangle(n);
-    std::thread printer([&]() {
-        printer_thread(triangle);
-    });
+    if (!journal_file.empty()) {
+        merge_files.insert(merge_files.begin(), journal_file);
+    }
+    for (const std::string& filename : merge_files) {
+        int contradictions = 0;
+        int count = TriangleJournal::load(filename, [&](bool is_upper, int n, int k, int t) {
+            if (!triangle.apply_journal_fact(is_upper, n, k, t)) {
+                log_message("%s: t(%d,%d) %s %d contradicts what we already know; ignoring it\n",
+                            filename.c_str(), n, k, is_upper ? "<=" : ">=", t);
+                contradictions += 1;
+            }
+        });
+        if (count >= 0) {
+            log_message("Loaded %d facts from %s\n", count - contradictions, filename.c_str());
+        } else if (filename != journal_file) {
+            fprintf(stderr, "Failed to read %s\n", filename.c_str());
+            exit(1);
+        }
+    }
+    if (!journal_file.empty() && !triangle.journal.open_for_append(journal_file)) {
+        fprintf(stderr, "Failed to open %s for appending\n", journal_file.c_str());
+        exit(1);
+    }
+    std::thread events(event_thread, &triangle, std::max(snapshot_interval, 1), std::cref(stop_events));
+    if (!serve_address.empty()) {
+        int listen_fd = listen_on(serve_address);
+        if (listen_fd < 0) {
+            fprintf(stderr, "Failed to listen on %s: %s\n", serve_address.c_str(), strerror(errno));
+            exit(1);
+        }
+        std::thread([&triangle, listen_fd]() {
+            accept_remote_workers(triangle, listen_fd);
+        }).detach();
+    }
     std::vector<std::thread> workers;
-    for (int i=0; i < NUM_THREADS; ++i) {
-        workers.emplace_back([&]() {
+    for (int i=0; i < num_threads; ++i) {
+        workers.emplace_back([&, i]() {
+            pin_worker(cpus, i, search_threads);
             while (true) {
-                worker_thread(triangle);
+                worker_thread(triangle, search_threads);
             }
         });
     }
-    printer.join();  // block forever
+    events.join();  // block forever
 }
@@ -1,26 +1,119 @@
 
 #include <assert.h>
+#include <atomic>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <vector>
 #include "wolves.h"
 
+static void print_usage()
+{
+    printf("Usage:\n");
+    printf("  ./st n k t   -- solve (n,k) in t tests\n");
+    printf("  ./st n k t s -- ...each involving s animals\n");
+    printf("  ./st         -- print the triangle of solutions t(n,k)\n");
+    printf("  ./st r       -- ...having precomputed the first r rows\n");
+    printf("Options:\n");
+    printf("  --transposition-table MB  -- remember hopeless positions (see wolves.h)\n");
+    printf("  --threads N               -- search each (n,k,t) on N threads\n");
+    printf("  --checkpoint-dir DIR      -- save each search's progress in DIR\n");
+    printf("  --checkpoint-interval S   -- ...every S seconds (default 600)\n");
+    printf("  --resume                  -- ...and pick up from any saved progress\n");
+    printf("  --prune-stats             -- report how often each bound pruned the search\n");
+    printf("  --stats S                 -- report on each long search every S seconds\n");
+}
+
+static void print_prune_stats(const NktResult& result)
+{
+    fprintf(stderr, "PRUNED n=%d k=%d t=%d", result.n, result.k, result.t);
+    for (int r = 0; r < kNumPruneReasons; ++r) {
+        fprintf(stderr, " %s=%llu", prune_reason_name(PruneReason(r)), (unsigned long long)result.pruned[r]);
+    }
+    fprintf(stderr, "\n");
+}
+
+static std::atomic<bool> g_interrupted(false);
+
+static void handle_sigint(int)
+{
+    g_interrupted = true;
+}
+
 int main(int argc, char **argv)
 {
+    int num_threads = 1;
+    std::string checkpoint_dir;
+    int checkpoint_interval = 600;
+    bool resume = false;
+    bool prune_stats = false;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; ++i) {
+        if (strcmp(argv[i], "--transposition-table") == 0 && i+1 < argc) {
+            solve_wolves_use_transposition_table(size_t(atoi(argv[++i])) << 20);
+        } else if (strcmp(argv[i], "--threads") == 0 && i+1 < argc) {
+            num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--checkpoint-dir") == 0 && i+1 < argc) {
+            checkpoint_dir = argv[++i];
+        } else if (strcmp(argv[i], "--checkpoint-interval") == 0 && i+1 < argc) {
+            checkpoint_interval = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--resume") == 0) {
+            resume = true;
+        } else if (strcmp(argv[i], "--prune-stats") == 0) {
+            prune_stats = true;
+        } else if (strcmp(argv[i], "--stats") == 0 && i+1 < argc) {
+            solve_wolves_report_stats(atoi(argv[++i]), [](const SearchStats& stats) {
+                fprintf(stderr, "%s", search_stats_line(stats).c_str());
+            });
+        } else {
+            print_usage();
+            exit(1);
+        }
+    }
+    // Shift the options out of the way.
+    argc -= (i - 1);
+    argv += (i - 1);
+
+    if (resume && checkpoint_dir.empty()) {
+        printf("--resume requires --checkpoint-dir\n");
+        exit(1);
+    }
+    if (!checkpoint_dir.empty()) {
+        solve_wolves_use_checkpoints(checkpoint_dir, checkpoint_interval, resume);
+        // Let ^C stop the search cleanly, so that it saves its progress on the way out.
+        signal(SIGINT, handle_sigint);
+    }
+
+    auto solve = [num_threads, prune_stats](int n, int k, int t) {
+        NktResult result = solve_wolves(n, k, t, []() { return g_interrupted.load(); }, num_threads);
+        if (prune_stats) {
+            print_prune_stats(result);
+        }
+        if (result.status == NktStatus::Terminated) {
+            printf("Interrupted while solving n=%d k=%d t=%d; rerun with --resume to continue.\n", n, k, t);
+            exit(1);
+        }
+        return result;
+    };
+
     if (argc == 4) {
         int n = atoi(argv[1]);
         int k = atoi(argv[2]);
         int t = atoi(argv[3]);
-        NktResult result = solve_wolves(n, k, t);
-        printf("%s\n", result.message.c_str());
+        NktResult result = solve(n, k, t);
+        printf("%s\n", nkt_result_message(result).c_str());
     } else if (argc == 5) {
         int n = atoi(argv[1]);
         int k = atoi(argv[2]);
         int t = atoi(argv[3]);
         int s = atoi(argv[4]);
         NktResult result = solve_wolves(n, k, t, s);
-        printf("%s\n", result.message.c_str());
+        if (prune_stats) {
+            print_prune_stats(result);
+        }
+        printf("%s\n", nkt_result_message(result).c_str());
     } else if (argc == 1 || argc == 2) {
         int n = (argc == 2) ? atoi(argv[1]) : 0;
         std::vector<int> triangle;
@@ -49,9 +142,9 @@ int main(int argc, char **argv)
             triangle.push_back(0);
             for (int k = 0; k <= n; ++k) {
                 for (int t = triangle[k]; t <= n-1; ++t) {
-                    NktResult result = solve_wolves(n, k, t);
-                    printf("%s", result.message.c_str());
-                    if (result.success) {
+                    NktResult result = solve(n, k, t);
+                    printf("%s", nkt_result_message(result).c_str());
+                    if (result.success()) {
                         triangle[k] = t;
                         break;
                     }
@@ -62,10 +155,6 @@ int main(int argc, char **argv)
             printf("\n");
         }
     } else {
-        printf("Usage:\n");
-        printf("  ./st n k t   -- solve (n,k) in t tests\n");
-        printf("  ./st n k t s -- ...each involving s animals\n");
-        printf("  ./st         -- print the triangle of solutions t(n,k)\n");
-        printf("  ./st r       -- ...having precomputed the first r rows\n");
+        print_usage();
     }
 }
@@ -0,0 +1,72 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "solution_db.h"
+#include "solution_file.h"
+
+static void usage()
+{
+    puts("./sdb pack in.txt out.db        Pack a text solution file into a solution database");
+    puts("./sdb text in.db out.txt        Unpack it into the '1'/'.' text format");
+    puts("./sdb emathgroup in.db out.txt  Unpack it into the emathgroup hex format");
+    puts("./sdb list in.db                List the (n,d,t) of each entry");
+    puts("./sdb show in.db N D            Print the entry for (N,D)");
+}
+
+static void open_or_die(SolutionDb& db, const char *filename)
+{
+    if (!db.open(filename)) {
+        printf("Failed to open solution database '%s'\n", filename);
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 4 && strcmp(argv[1], "pack") == 0) {
+        std::vector<SolutionFileEntry> entries;
+        if (!read_solution_file(argv[2], [&](SolutionFileEntry&& entry) { entries.push_back(std::move(entry)); })) {
+            printf("Failed to open solution file '%s'\n", argv[2]);
+            exit(EXIT_FAILURE);
+        }
+        if (!write_solution_db(argv[3], std::move(entries))) {
+            printf("Failed to write solution database '%s'\n", argv[3]);
+            exit(EXIT_FAILURE);
+        }
+    } else if (argc == 4 && (strcmp(argv[1], "text") == 0 || strcmp(argv[1], "emathgroup") == 0)) {
+        SolutionDb db;
+        open_or_die(db, argv[2]);
+        std::ofstream outfile(argv[3]);
+        for (size_t i = 0; i < db.size(); ++i) {
+            write_solution_entry(outfile, db.read(i), argv[1][0] == 'e');
+        }
+        if (!outfile) {
+            printf("Failed to write solution file '%s'\n", argv[3]);
+            exit(EXIT_FAILURE);
+        }
+    } else if (argc == 3 && strcmp(argv[1], "list") == 0) {
+        SolutionDb db;
+        open_or_die(db, argv[2]);
+        for (size_t i = 0; i < db.size(); ++i) {
+            const SolutionDbEntry& e = db.entry(i);
+            printf("N=%u D=%u T=%u guaranteed_best=%d\n", e.n, e.d, e.t, int(e.guaranteed_best()));
+        }
+    } else if (argc == 5 && strcmp(argv[1], "show") == 0) {
+        SolutionDb db;
+        open_or_die(db, argv[2]);
+        long i = db.find(atoi(argv[3]), atoi(argv[4]));
+        if (i < 0) {
+            printf("No entry for N=%s D=%s\n", argv[3], argv[4]);
+            exit(EXIT_FAILURE);
+        }
+        for (auto&& test : db.read(i).tests) {
+            printf("%s\n", test.c_str());
+        }
+    } else {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+}
@@ -1,12 +1,28 @@
+#include <algorithm>
 #include <array>
 #include <cassert>
-#include <set>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <map>
+#include <memory>
+#include <set>
 #include <stdio.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unistd.h>
 #include <vector>
-#if USE_MEMORY_RESOURCE
-#include <memory_resource>
-#endif
+#include "combinations.h"
+#include "duplicate_finder.h"
+#include "solution_db.h"
+#include "solution_file.h"
+#include "verify_strategy.h"
 
 using Int = unsigned long long;
 
@@ -32,38 +48,65 @@ static constexpr Int choose() {
     return grid[n][k];
 }
 
-template<class TS, class = void>
-struct TestResults {
-    std::vector<bool> data_;
-    void push_back(bool b) {
-        data_.push_back(b);
-    }
-    friend bool operator<(const TestResults& a, const TestResults& b) {
-        return a.data_ < b.data_;
-    }
+// A strategy's test matrix as one bitmask per animal: bit j of column[i]
+// is set if test j involves animal i. The results of all the tests for
+// some arrangement of wolves are then just the OR of the wolves' columns.
+template<class TS>
+struct ColumnTable {
+    static_assert(TS::t <= 128, "the results of all the tests must fit in 128 bits");
+    using Mask = std::conditional_t<(TS::t <= 64), uint64_t, unsigned __int128>;
+    std::array<Mask, TS::n> column {};
 };
+
 template<class TS>
-struct TestResults<TS, std::enable_if_t<(TS::t <= 64)>> {
-    uint64_t data_;
-    void push_back(bool b) {
-        data_ <<= 1;
-        data_ |= uint64_t(b);
+constexpr ColumnTable<TS> make_column_table() {
+    ColumnTable<TS> result {};
+    for (int t = 0; t < TS::t; ++t) {
+        for (int i = 0; i < TS::n; ++i) {
+            if (TS::test_contains_animal(t, i)) {
+                result.column[i] |= typename ColumnTable<TS>::Mask(1) << t;
+            }
+        }
     }
-    friend bool operator<(const TestResults& a, const TestResults& b) {
-        return a.data_ < b.data_;
+    return result;
+}
+
+template<class TS>
+constexpr bool column_table_matches(const ColumnTable<TS>& table) {
+    for (int t = 0; t < TS::t; ++t) {
+        for (int i = 0; i < TS::n; ++i) {
+            if (bool((table.column[i] >> t) & 1) != TS::test_contains_animal(t, i)) {
+                return false;
+            }
+        }
     }
+    return true;
+}
+
+// Whether TS::test_contains_animal can be evaluated at compile time.
+template<class TS, bool = (TS::test_contains_animal(0, 0), true)>
+constexpr bool has_constexpr_tests(int) { return true; }
+template<class TS>
+constexpr bool has_constexpr_tests(...) { return false; }
+
+template<class TS, bool = has_constexpr_tests<TS>(0)>
+struct Columns {
+    static constexpr ColumnTable<TS> table = make_column_table<TS>();
+    static_assert(column_table_matches<TS>(table), "the column table disagrees with test_contains_animal");
 };
+
+// Strategies built out of std::sets of blocks can't be evaluated at compile
+// time, so we build their tables once, at startup.
 template<class TS>
-struct TestResults<TS, std::enable_if_t<(64 < TS::t && TS::t <= 128)>> {
-    unsigned __int128 data_;
-    void push_back(bool b) {
-        data_ <<= 1;
-        data_ |= (unsigned __int128)(b);
-    }
-    friend bool operator<(const TestResults& a, const TestResults& b) {
-        return a.data_ < b.data_;
-    }
+struct Columns<TS, false> {
+    static const ColumnTable<TS> table;
 };
+template<class TS>
+const ColumnTable<TS> Columns<TS, false>::table = [] {
+    ColumnTable<TS> result = make_column_table<TS>();
+    assert(column_table_matches<TS>(result));
+    return result;
+}();
 
 struct WolfArrangement {
     std::vector<int> v_;
@@ -79,16 +122,6 @@ struct WolfArrangement {
         return false;
     }
 
-    template<class TS>
-    bool test_is_wolfy(int t) const {
-        for (int i : v_) {
-            if (TS::test_contains_animal(t, i)) {
-                return true;
-            }
-        }
-        return false;
-    }
-
     template<class TS>
     void increment() {
         // Increment the first possible animal index,
@@ -115,13 +148,13 @@ struct WolfArrangement {
     }
 };
 
+// The arrangement that increment() reaches after "rank" steps from the first.
+// increment() goes in colex order; see combinations.h.
 template<class TS>
-WolfArrangement wolf_arrangement_from_index(int id) {
-    assert((0 <= id && id < choose<TS::n, TS::k>()));
+WolfArrangement wolf_arrangement_from_rank(Int rank, const BinomialTable& binomials) {
+    assert((rank < choose<TS::n, TS::k>()));
     WolfArrangement result(TS::k);
-    for (int i=0; i < id; ++i) {
-        result.increment<TS>();
-    }
+    colex_unrank(rank, TS::n, TS::k, result.v_.data(), binomials);
     return result;
 }
 
@@ -129,7 +162,7 @@ struct T_8_2 {
     static constexpr int n = 8;
     static constexpr int k = 2;
     static constexpr int t = 6;
-    static bool test_contains_animal(int t, int i) {
+    static constexpr bool test_contains_animal(int t, int i) {
         switch (t) {
             case 0: return "T..TT..."[i] == 'T';
             case 1: return "T....TT."[i] == 'T';
@@ -147,7 +180,7 @@ struct T_14_3 {
     static constexpr int n = 14;
     static constexpr int k = 3;
     static constexpr int t = 12;
-    static bool test_contains_animal(int t, int i) {
+    static constexpr bool test_contains_animal(int t, int i) {
         switch (i) {
             case  0: return "100000001100"[t] == '1';
             case  1: return "000001010001"[t] == '1';
@@ -199,7 +232,7 @@ struct T_100_5_noedne {
 
     static constexpr const T_100_5_cache cached_ = T_100_5_cacheit_();
 
-    static bool test_contains_animal(int t, int i) {
+    static constexpr bool test_contains_animal(int t, int i) {
         return cached_.data_[t][i];
     }
 };
@@ -210,7 +243,7 @@ struct T_111_3 {
     static constexpr int k = 3;
     static constexpr int t = 37;
 
-    static bool test_contains_animal(int t, int n) {
+    static constexpr bool test_contains_animal(int t, int n) {
         // Each animal n is tested exactly 4 times;
         // no pair of animals is tested twice together.
         // Thanks to @Elaqqad for this example!
@@ -470,71 +503,71 @@ struct T_100_5_elaqqad_for_dummies {
     static constexpr int n = 100;
     static constexpr int k = 5;
     static constexpr int t = 59;
-    static bool test_contains_animal(int t, int i) {
-        static const char m[59][101] = {
-            "11111111111.........................................................................................",
-            "1..........1111111111...............................................................................",
-            "1....................1111111111.....................................................................",
-            "1..............................1111111111...........................................................",
-            "1........................................1111111111.................................................",
-            "1..................................................1111111111.......................................",
-            "1............................................................1111111111.............................",
-            "1......................................................................1111111111...................",
-            ".1.........1.........1.........1.........1.........1.........1.........1.........111................",
-            "..1.........1.........1.........1.........1.........1.........1.........1........1..11..............",
-            "...1.........1.........1.........1.........1.........1.........1.........1.......1....11............",
-            "....1.........1.........1.........1.........1.........1.........1.........1......1......11..........",
-            ".....1.........1.........1.........1.........1.........1.........1.........1.....1........11........",
-            "......1.........1.........1.........1.........1.........1.........1.........1....1..........11......",
-            ".......1.........1.........1.........1.........1.........1.........1.........1...1............11....",
-            "........1.........1.........1.........1.........1.........1.........1.........1..1..............11..",
-            "....1..............1.......1....1................1.....1............1.......1.....1...1.............",
-            "........1......1.............1......1....1.................1.......1......1.........1.1.............",
-            "....1.............1...........1.....1.....1..............1...........1.....1.......1...1............",
-            ".....1.....1............1..............1.........1........1.......1..........1.......1.1............",
-            "...1........1.............1.............1....1...........1............1.......1...1.....1...........",
-            ".........1.......1.....1...........1..............1.......1..1..............1.......1...1...........",
-            "..........1.....1..........1.......1............1...........1.1..........1.........1.....1..........",
-            "......1...........1..........1.......1.......1.......1.......1.................1.....1...1..........",
-            "......1.............1.......1.....1........1...............1..1..............1....1.......1.........",
-            "..........1.1................1........1........1...1............1...........1..........1..1.........",
-            "........1....1........1.................1.........1.....1.......1............1.....1.......1........",
-            ".........1.1..................1......1........1.......1.......1...............1.......1....1........",
-            "..........11................1....1..........1............1.......1..............1...1.......1.......",
-            "..1................1.1..................1..1..............1........1.......1.............1..1.......",
-            ".......1...........1.....1.......1.......1..................1...1.............1......1.......1......",
-            "........1...........1......1...........1..1..........1...........1.....1................1....1......",
-            "...1............1...........1..1..................1....1.............1....1..........1........1.....",
-            ".1.............1..............1.......1....1................1.....1.....1...............1.....1.....",
-            ".........1....1......1...........1........1.............1...........1..........1..........1...1.....",
-            ".....1.......1...............1..1...............1.....1...............11....................1.1.....",
-            ".1................1......1........1..............1......1.............1..1..........1..........1....",
-            "...1...........1......1................1......1....1................1...........1........1.....1....",
-            "......1............1...1..............1.....1.......1................1.1...................1...1....",
-            ".........1..1...........1......1................1..........1...1...........1.................1.1....",
-            ".......1......1........1........1............1.............1......1.............1..1............1...",
-            ".1..............1.......1...............1......1....1............1.............1......1.........1...",
-            "..1..............1........1............1.1............1..............1...1................1.....1...",
-            "....1...............1....1...........1............11...........1........1...................1...1...",
-            ".....1...........1....1.............1.......1...............1..1...............1..1..............1..",
-            ".......1............11.............1..........1.....1.................1...1............1.........1..",
-            "..........1...1...........1....1.................1...1.............1....1..................1.....1..",
-            "..1..........1................1...1............1.......1.....1..................1............1...1..",
-            "...1..........1..........1..........1..........1..........1...1........1..........................1.",
-            "........1...1........1...............1......1..........1..........1......1........................1.",
-            ".1...............1..........1...1.............1......1..........1..........1......................1.",
-            "....1..........1..........1......1..............1...1........1...............1....................1.",
-            ".........1..........1........1..........1........1..........1........1..........1.................1.",
-            "..................................................................................1.1..1.1.1.11.1.1.",
-            "......1......1..........1..........1.....1...............1..........1...1..........................1",
-            "..1........1...............1..........1......1..........1......1..........1........................1",
-            ".......1..........1...1........1...........1..........1..........1..........1......................1",
-            "..........1........1..........1........1..........1........1..........1........1...................1",
-            "...................................................................................1.11.1.1.1..1.1.1",
-        };
+    static constexpr char m[59][101] = {
+        "11111111111.........................................................................................",
+        "1..........1111111111...............................................................................",
+        "1....................1111111111.....................................................................",
+        "1..............................1111111111...........................................................",
+        "1........................................1111111111.................................................",
+        "1..................................................1111111111.......................................",
+        "1............................................................1111111111.............................",
+        "1......................................................................1111111111...................",
+        ".1.........1.........1.........1.........1.........1.........1.........1.........111................",
+        "..1.........1.........1.........1.........1.........1.........1.........1........1..11..............",
+        "...1.........1.........1.........1.........1.........1.........1.........1.......1....11............",
+        "....1.........1.........1.........1.........1.........1.........1.........1......1......11..........",
+        ".....1.........1.........1.........1.........1.........1.........1.........1.....1........11........",
+        "......1.........1.........1.........1.........1.........1.........1.........1....1..........11......",
+        ".......1.........1.........1.........1.........1.........1.........1.........1...1............11....",
+        "........1.........1.........1.........1.........1.........1.........1.........1..1..............11..",
+        "....1..............1.......1....1................1.....1............1.......1.....1...1.............",
+        "........1......1.............1......1....1.................1.......1......1.........1.1.............",
+        "....1.............1...........1.....1.....1..............1...........1.....1.......1...1............",
+        ".....1.....1............1..............1.........1........1.......1..........1.......1.1............",
+        "...1........1.............1.............1....1...........1............1.......1...1.....1...........",
+        ".........1.......1.....1...........1..............1.......1..1..............1.......1...1...........",
+        "..........1.....1..........1.......1............1...........1.1..........1.........1.....1..........",
+        "......1...........1..........1.......1.......1.......1.......1.................1.....1...1..........",
+        "......1.............1.......1.....1........1...............1..1..............1....1.......1.........",
+        "..........1.1................1........1........1...1............1...........1..........1..1.........",
+        "........1....1........1.................1.........1.....1.......1............1.....1.......1........",
+        ".........1.1..................1......1........1.......1.......1...............1.......1....1........",
+        "..........11................1....1..........1............1.......1..............1...1.......1.......",
+        "..1................1.1..................1..1..............1........1.......1.............1..1.......",
+        ".......1...........1.....1.......1.......1..................1...1.............1......1.......1......",
+        "........1...........1......1...........1..1..........1...........1.....1................1....1......",
+        "...1............1...........1..1..................1....1.............1....1..........1........1.....",
+        ".1.............1..............1.......1....1................1.....1.....1...............1.....1.....",
+        ".........1....1......1...........1........1.............1...........1..........1..........1...1.....",
+        ".....1.......1...............1..1...............1.....1...............11....................1.1.....",
+        ".1................1......1........1..............1......1.............1..1..........1..........1....",
+        "...1...........1......1................1......1....1................1...........1........1.....1....",
+        "......1............1...1..............1.....1.......1................1.1...................1...1....",
+        ".........1..1...........1......1................1..........1...1...........1.................1.1....",
+        ".......1......1........1........1............1.............1......1.............1..1............1...",
+        ".1..............1.......1...............1......1....1............1.............1......1.........1...",
+        "..1..............1........1............1.1............1..............1...1................1.....1...",
+        "....1...............1....1...........1............11...........1........1...................1...1...",
+        ".....1...........1....1.............1.......1...............1..1...............1..1..............1..",
+        ".......1............11.............1..........1.....1.................1...1............1.........1..",
+        "..........1...1...........1....1.................1...1.............1....1..................1.....1..",
+        "..1..........1................1...1............1.......1.....1..................1............1...1..",
+        "...1..........1..........1..........1..........1..........1...1........1..........................1.",
+        "........1...1........1...............1......1..........1..........1......1........................1.",
+        ".1...............1..........1...1.............1......1..........1..........1......................1.",
+        "....1..........1..........1......1..............1...1........1...............1....................1.",
+        ".........1..........1........1..........1........1..........1........1..........1.................1.",
+        "..................................................................................1.1..1.1.1.11.1.1.",
+        "......1......1..........1..........1.....1...............1..........1...1..........................1",
+        "..1........1...............1..........1......1..........1......1..........1........................1",
+        ".......1..........1...1........1...........1..........1..........1..........1......................1",
+        "..........1........1..........1........1..........1........1..........1........1...................1",
+        "...................................................................................1.11.1.1.1..1.1.1",
+    };
+
+    static constexpr bool test_contains_animal(int t, int i) {
         return m[t][i] == '1';
     }
-
 };
 
 struct T_26_3 {
@@ -542,7 +575,7 @@ struct T_26_3 {
     static constexpr int k = 3;
     static constexpr int t = 19;
 
-    static bool test_contains_animal(int t, int i) {
+    static constexpr bool test_contains_animal(int t, int i) {
         if (i == 25) return false;
         switch (t / 5) {
             case 0: return (t % 5) == ((i+0*(i/5)) % 5);
@@ -559,7 +592,7 @@ struct T_21_3 {
     static constexpr int k = 3;
     static constexpr int t = 18;
 
-    static bool test_contains_animal(int t, int i) {
+    static constexpr bool test_contains_animal(int t, int i) {
         if (i == 20) return false;
         switch (t / 5) {
             case 0: return (t % 5) == ((i+0*(i/5)) % 5);
@@ -576,7 +609,7 @@ struct T_17_3 {
     static constexpr int k = 3;
     static constexpr int t = 15;
 
-    static bool test_contains_animal(int t, int i) {
+    static constexpr bool test_contains_animal(int t, int i) {
         if (i == 16) return false;
         switch (t / 4) {
             case 0: return (t % 4) == "aaaabbbbccccdddd"[i] - 'a';
@@ -601,32 +634,43 @@ void print_wolves(const WolfArrangement& w) {
 }
 
 template<class TS>
-TestResults<TS> run_tests(const WolfArrangement& w) {
-    TestResults<TS> r;
-    for (int i=0; i < TS::t; ++i) {
-        r.push_back(w.test_is_wolfy<TS>(i));
+typename ColumnTable<TS>::Mask run_tests(const WolfArrangement& w) {
+    typename ColumnTable<TS>::Mask r = 0;
+    for (int i : w.v_) {
+        r |= Columns<TS>::table.column[i];
     }
     return r;
 }
 
 template<class TS>
-bool verify_strategy() {
-    WolfArrangement wolves(TS::k);
-#if USE_MEMORY_RESOURCE
-    std::pmr::map<TestResults<TS>, int> tr;
-#else
-    std::map<TestResults<TS>, int> tr;
-#endif
-    tr.insert(std::make_pair(run_tests<TS>(wolves), 0));
-    for (Int id=1; id < choose<TS::n, TS::k>(); ++id) {
-        wolves.increment<TS>();
-        auto ii = tr.insert(std::make_pair(run_tests<TS>(wolves), id));
-        if (ii.second == false) {
-            printf("Failure! These wolf arrangements cannot be distinguished:\n");
-            print_wolves<TS>(wolf_arrangement_from_index<TS>(ii.first->second));
-            print_wolves<TS>(wolves);
-            return false;
+bool verify_strategy(DuplicateEngine engine, int num_threads) {
+    using Key = typename ColumnTable<TS>::Mask;
+    const BinomialTable binomials(TS::n, TS::k);
+    // Call f(wolves, results) for the arrangements of ranks [begin, end), until it returns false.
+    auto for_each_arrangement = [&](Int begin, Int end, const auto& f) {
+        if (begin == end) return;
+        WolfArrangement wolves = wolf_arrangement_from_rank<TS>(begin, binomials);
+        for (Int id=begin; id < end; ++id) {
+            if (id != begin) wolves.increment<TS>();
+            if (!f(wolves, run_tests<TS>(wolves))) return;
+        }
+    };
+    const Int count = choose<TS::n, TS::k>();
+    const size_t budget = default_duplicate_memory_budget();
+    if (engine == DuplicateEngine::Automatic) {
+        engine = choose_duplicate_engine<Key>(count, budget, num_threads);
+    }
+    printf("Checking %llu wolf arrangements with the %s engine on %d threads\n", count, duplicate_engine_name(engine), num_threads);
+    auto generate = [&](Int begin, Int end, const auto& emit) {
+        for_each_arrangement(begin, end, [&](const WolfArrangement&, const Key& r) { return emit(r); });
+    };
+    Key dup;
+    if (find_duplicate(engine, count, budget, num_threads, generate, &dup)) {
+        printf("Failure! These wolf arrangements cannot be distinguished:\n");
+        for (Int rank : find_ranks_of(dup, count, num_threads, generate)) {
+            print_wolves<TS>(wolf_arrangement_from_rank<TS>(rank, binomials));
         }
+        return false;
     }
     return true;
 }
@@ -645,13 +689,209 @@ void print_strategy(bool line_numbers) {
     }
 }
 
-int main() {
-#if USE_MEMORY_RESOURCE
-    std::pmr::monotonic_buffer_resource mr(1'000'000);
-    std::pmr::set_default_resource(&mr);
-#endif
-    using T = T_26_3;
-    if (verify_strategy<T>()) {
-        print_strategy<T>(false);
+// Everything vs knows how to verify: the strategies above, plus any
+// matrices loaded with --file.
+struct Verifier {
+    std::string name;
+    int n, k, t;
+    std::function<bool(DuplicateEngine, int)> verify;
+    std::function<void()> print;
+};
+
+template<class TS>
+Verifier builtin_verifier(const char *name) {
+    return Verifier{ name, TS::n, TS::k, TS::t, verify_strategy<TS>, [] { print_strategy<TS>(false); } };
+}
+
+#define BUILTIN(TS) builtin_verifier<TS>(#TS)
+
+static std::vector<Verifier> builtin_verifiers() {
+    return {
+        BUILTIN(T_8_2),
+        BUILTIN(T_14_3),
+        BUILTIN(T_17_3),
+        BUILTIN(T_21_3),
+        BUILTIN(T_26_3),
+        BUILTIN(T_111_3),
+        BUILTIN(T_96_5),
+        BUILTIN(T_100_5_noedne),
+        BUILTIN(T_100_5_elaqqad),
+        BUILTIN(T_100_5_elaqqad_for_dummies),
+        BUILTIN(T_273_5),
+    };
+}
+
+#undef BUILTIN
+
+static Verifier file_verifier(const std::string& filename, SolutionFileEntry&& entry) {
+    Verifier v;
+    v.name = filename + ":" + std::to_string(entry.n) + "," + std::to_string(entry.d);
+    v.n = entry.n;
+    v.k = entry.d;
+    v.t = entry.t;
+    auto tests = std::make_shared<std::vector<std::string>>(std::move(entry.tests));
+    v.verify = [n = v.n, d = v.k, tests](DuplicateEngine engine, int num_threads) {
+        printf("Checking %llu wolf arrangements on %d threads\n", BinomialTable(n, d)(n, d), num_threads);
+        VerifyStrategyResult r = verify_strategy(n, d, *tests, engine, num_threads);
+        if (!r.success) {
+            printf("Failure! These wolf arrangements cannot be distinguished:\n%s\n%s\n", r.w1.c_str(), r.w2.c_str());
+        }
+        return r.success;
+    };
+    v.print = [tests]() {
+        for (const std::string& test : *tests) {
+            printf("%s\n", test.c_str());
+        }
+    };
+    return v;
+}
+
+// Verify each strategy in a child process of its own, up to num_jobs at a
+// time. Each child's output is held in a temporary file and printed in one
+// piece when it exits, followed by its wall-clock time and peak memory.
+// Return the number of strategies that failed (or crashed).
+static int verify_in_batch(const std::vector<Verifier>& verifiers, DuplicateEngine engine, int num_threads, int num_jobs, bool print) {
+    struct Job {
+        const Verifier *verifier;
+        FILE *out;
+        struct timeval start;
+    };
+    std::map<pid_t, Job> running;
+    int failures = 0;
+
+    auto wait_for_one = [&]() {
+        int status;
+        struct rusage usage;
+        pid_t pid = wait4(-1, &status, 0, &usage);
+        assert(pid > 0);
+        struct timeval end;
+        gettimeofday(&end, nullptr);
+        Job job = running.at(pid);
+        running.erase(pid);
+
+        fflush(stdout);
+        rewind(job.out);
+        char buffer[4096];
+        size_t len;
+        while ((len = fread(buffer, 1, sizeof buffer, job.out)) != 0) {
+            fwrite(buffer, 1, len, stdout);
+        }
+        fclose(job.out);
+
+        const char *outcome = "ok";
+        if (WIFSIGNALED(status)) {
+            outcome = "CRASHED";
+        } else if (WEXITSTATUS(status) != 0) {
+            outcome = "FAILED";
+        }
+        failures += (outcome[0] != 'o');
+        double seconds = (end.tv_sec - job.start.tv_sec) + (end.tv_usec - job.start.tv_usec) / 1e6;
+        printf("%-40s %-7s %10.2fs %8ld MB\n", job.verifier->name.c_str(), outcome, seconds, usage.ru_maxrss / 1024);
+        fflush(stdout);
+    };
+
+    for (const Verifier& v : verifiers) {
+        while ((int)running.size() >= num_jobs) {
+            wait_for_one();
+        }
+        Job job { &v, tmpfile(), {} };
+        assert(job.out != nullptr);
+        fflush(stdout);
+        gettimeofday(&job.start, nullptr);
+        pid_t pid = fork();
+        assert(pid >= 0);
+        if (pid == 0) {
+            dup2(fileno(job.out), STDOUT_FILENO);
+            printf("%s: n=%d d=%d t=%d\n", v.name.c_str(), v.n, v.k, v.t);
+            bool success = v.verify(engine, num_threads);
+            if (success && print) {
+                v.print();
+            }
+            fflush(stdout);
+            _exit(success ? 0 : 1);
+        }
+        running.emplace(pid, job);
+    }
+    while (!running.empty()) {
+        wait_for_one();
+    }
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    std::vector<Verifier> builtins = builtin_verifiers();
+    std::vector<Verifier> selected;
+    DuplicateEngine engine = DuplicateEngine::Automatic;
+    int num_threads = std::max(1u, std::thread::hardware_concurrency());
+    int num_jobs = 1;
+    bool print = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--help") == 0) {
+            puts("./vs [--list] [--all] [--file f.txt] [--engine E] [--threads T] [--jobs J] [--print] [NAME...]");
+            puts("");
+            puts("Verify that strategies are D-separable. With no strategies named, verify");
+            puts("and print T_26_3.");
+            puts("  --list          List the built-in strategies");
+            puts("  --all           Verify every built-in strategy");
+            puts("  --file f.txt    Verify every strategy in this file (wolfy-out.txt format,");
+            puts("                  or a solution database made by ./sdb)");
+            puts("  --engine E      Look for indistinguishable wolves with E: map, hash, or sort");
+            puts("  --threads T     Verify each strategy with T threads (default: one per CPU)");
+            puts("  --jobs J        Verify J strategies at once (default: 1)");
+            puts("  --print         Print each strategy that verifies");
+            exit(0);
+        } else if (strcmp(argv[i], "--list") == 0) {
+            for (const Verifier& v : builtins) {
+                printf("%-30s n=%d d=%d t=%d\n", v.name.c_str(), v.n, v.k, v.t);
+            }
+            exit(0);
+        } else if (strcmp(argv[i], "--all") == 0) {
+            selected.insert(selected.end(), builtins.begin(), builtins.end());
+        } else if (strcmp(argv[i], "--file") == 0 && argv[i+1] != nullptr) {
+            std::string filename = argv[++i];
+            bool opened = read_any_solution_file(filename.c_str(), [&](SolutionFileEntry&& entry) {
+                selected.push_back(file_verifier(filename, std::move(entry)));
+            });
+            if (!opened) {
+                printf("Failed to open solution file '%s'\n", filename.c_str());
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--engine") == 0 && argv[i+1] != nullptr) {
+            ++i;
+            for (DuplicateEngine e : { DuplicateEngine::Map, DuplicateEngine::HashSet, DuplicateEngine::Sort }) {
+                if (strcmp(argv[i], duplicate_engine_name(e)) == 0) {
+                    engine = e;
+                }
+            }
+            if (engine == DuplicateEngine::Automatic) {
+                printf("Unrecognized engine '%s'; --help for help\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--threads") == 0 && argv[i+1] != nullptr) {
+            num_threads = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--jobs") == 0 && argv[i+1] != nullptr) {
+            num_jobs = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--print") == 0) {
+            print = true;
+        } else if (argv[i][0] == '-') {
+            printf("Unrecognized option '%s'; --help for help\n", argv[i]);
+            exit(EXIT_FAILURE);
+        } else {
+            auto it = std::find_if(builtins.begin(), builtins.end(), [&](const Verifier& v) { return v.name == argv[i]; });
+            if (it == builtins.end()) {
+                printf("Unrecognized strategy '%s'; --list for a list\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+            selected.push_back(*it);
+        }
+    }
+    if (selected.empty()) {
+        selected.push_back(builtin_verifier<T_26_3>("T_26_3"));
+        print = true;
+    }
+    int failures = verify_in_batch(selected, engine, num_threads, num_jobs, print);
+    if (selected.size() > 1) {
+        printf("%d of %d strategies verified\n", int(selected.size()) - failures, int(selected.size()));
     }
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
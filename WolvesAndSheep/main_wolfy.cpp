@@ -1,87 +1,144 @@
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <map>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
 #include <vector>
 
+#include "solution_db.h"
+#include "solution_file.h"
 #include "verify_strategy.h"
 
 enum class GuaranteedBest { Yes=1, No=0 };
 enum class BelongsInFile { Yes=1, No=0 };
 
+// A t-by-n test matrix, one bit per (test, animal): bit i of row r is set
+// if test r involves animal i. Each row is padded out to a whole number of words.
+class TestMatrix {
+public:
+    explicit TestMatrix(int n, int t) : n_(n), t_(t), words_((n + 63) / 64), bits_(size_t(t) * words_) {}
+
+    explicit TestMatrix(const std::vector<std::string>& tests) : TestMatrix(tests.empty() ? 0 : tests[0].size(), tests.size()) {
+        for (int r=0; r < t_; ++r) {
+            assert(tests[r].size() == n_);
+            for (int i=0; i < n_; ++i) {
+                if (tests[r][i] == '1') set(r, i);
+            }
+        }
+    }
+
+    int n() const { return n_; }
+    int t() const { return t_; }
+    bool get(int r, int i) const { return (row(r)[i / 64] >> (i % 64)) & 1; }
+    void set(int r, int i) { row(r)[i / 64] |= uint64_t(1) << (i % 64); }
+    const uint64_t *row(int r) const { return &bits_[size_t(r) * words_]; }
+    uint64_t *row(int r) { return &bits_[size_t(r) * words_]; }
+
+    // How many tests each animal is in.
+    std::vector<int> column_counts() const {
+        std::vector<int> counts(n_);
+        for (int r=0; r < t_; ++r) {
+            for (int w=0; w < words_; ++w) {
+                for (uint64_t bits = row(r)[w]; bits != 0; bits &= bits - 1) {
+                    counts[w * 64 + __builtin_ctzll(bits)] += 1;
+                }
+            }
+        }
+        return counts;
+    }
+
+    std::vector<std::string> to_strings() const {
+        std::vector<std::string> tests(t_, std::string(n_, '.'));
+        for (int r=0; r < t_; ++r) {
+            for (int i=0; i < n_; ++i) {
+                if (get(r, i)) tests[r][i] = '1';
+            }
+        }
+        return tests;
+    }
+
+private:
+    int n_;
+    int t_;
+    int words_;
+    std::vector<uint64_t> bits_;
+};
+
+// Most strategies are derived from other strategies, and most of them are
+// never printed or verified. So a Strategy knows its t up front, but builds
+// its test matrix only when someone asks for it, from the matrices of the
+// strategies it was derived from; after that the matrix is kept (and shared,
+// if a derived strategy uses the very same tests) and the recipe is dropped.
 struct Strategy {
-    std::function<std::vector<std::string>()> tests;
+    using Matrix = std::shared_ptr<const TestMatrix>;
+
     int t;
     GuaranteedBest guaranteed_best;
     BelongsInFile belongs_in_file;
 
     explicit Strategy(std::vector<std::string> testvec, GuaranteedBest gb, BelongsInFile bf) :
-        t(testvec.size()), guaranteed_best(gb), belongs_in_file(bf)
+        t(testvec.size()), guaranteed_best(gb), belongs_in_file(bf), matrix_(std::make_shared<const TestMatrix>(testvec))
     {
-        tests = [vec = std::move(testvec)]() { return vec; };
     }
 
-    explicit Strategy(int t, GuaranteedBest gb, BelongsInFile bf, std::function<std::vector<std::string>()> tests) :
-        t(t), guaranteed_best(gb), belongs_in_file(bf), tests(std::move(tests))
+    explicit Strategy(int t, GuaranteedBest gb, BelongsInFile bf, std::function<Matrix()> derive) :
+        t(t), guaranteed_best(gb), belongs_in_file(bf), derive_(std::move(derive))
     {
     }
 
+    const Matrix& matrix() const {
+        if (matrix_ == nullptr) {
+            matrix_ = derive_();
+            derive_ = nullptr;
+            assert(matrix_->t() == t);
+        }
+        return matrix_;
+    }
+
+    // The animal in the most tests (the first one, if there's a tie), and how many tests it's in.
+    std::pair<int, int> most_tested_animal() const {
+        if (most_tested_.first < 0) {
+            std::vector<int> counts = matrix()->column_counts();
+            auto it = std::max_element(counts.begin(), counts.end());
+            most_tested_ = std::make_pair(int(it - counts.begin()), *it);
+        }
+        return most_tested_;
+    }
+
+    std::vector<std::string> tests() const { return matrix()->to_strings(); }
+
     bool isBetterThan(const Strategy& rhs) const {
         if (t != rhs.t) return (t < rhs.t);
         if (guaranteed_best != rhs.guaranteed_best) return (guaranteed_best == GuaranteedBest::Yes);
         return false;
     }
 
-    std::string to_string(int n, int d) const {
-        std::ostringstream oss;
-        oss << "N=" << n << " D=" << d << " T=" << t;
-        oss << " guaranteed_best=" << ((guaranteed_best == GuaranteedBest::Yes) ? '1' : '0') << '\n';
-        auto concrete_tests = tests();
-        for (auto&& test : concrete_tests) {
-            oss << test << '\n';
-        }
-        return std::move(oss).str();
-    }
-
-    static std::string to_hex(unsigned long long bits) {
-        std::ostringstream oss;
-        oss << std::hex << bits;
-        return std::move(oss).str();
+    SolutionFileEntry to_entry(int n, int d) const {
+        return SolutionFileEntry{ n, d, t, guaranteed_best == GuaranteedBest::Yes, tests() };
     }
 
-    std::string to_emathgroup_string(int n, int d) const {
-        // This format comes from Zhao Hui Du, https://emathgroup.github.io/blog/two-poisoned-wine
+    std::string to_string(int n, int d) const {
         std::ostringstream oss;
-        oss << "N=" << n << " D=" << d << " T=" << t;
-        oss << " guaranteed_best=" << ((guaranteed_best == GuaranteedBest::Yes) ? '1' : '0') << '\n';
-        oss << "emathgroup";
-        int wordwrap = 10;
-        auto concrete_tests = tests();
-        for (int c=0; c < n; ++c) {
-            unsigned long long bits = 0;
-            for (int r = t-1; r >= 0; --r) {
-                bits = ((bits << 1) | (concrete_tests[r][c] == '1'));
-            }
-            std::string hexbits = to_hex(bits);
-            if (wordwrap + 1 + hexbits.size() > 75) {
-                oss << "\n" << hexbits;
-                wordwrap = hexbits.size();
-            } else {
-                oss << " " << hexbits;
-                wordwrap += 1 + hexbits.size();
-            }
-        }
-        oss << "\n";
+        write_solution_entry(oss, to_entry(n, d), false);
         return std::move(oss).str();
     }
 
+private:
+    mutable Matrix matrix_;
+    mutable std::function<Matrix()> derive_;
+    mutable std::pair<int, int> most_tested_ {-1, 0};
 };
 
 std::shared_ptr<Strategy> empty_strategy()
@@ -91,14 +148,24 @@ std::shared_ptr<Strategy> empty_strategy()
 
 std::shared_ptr<Strategy> perfect_strategy_for_one_wolf(int n)
 {
-    std::vector<std::string> tests;
+    int t = 0;
     for (int bit = 1; bit < n; bit <<= 1) {
-        tests.push_back(std::string(n, '.'));
-        for (int i=0; i < n; ++i) {
-            tests.back()[i] = ((i & bit) ? '1' : '.');
-        }
+        t += 1;
     }
-    return std::make_shared<Strategy>(std::move(tests), GuaranteedBest::Yes, BelongsInFile::No);
+    return std::make_shared<Strategy>(
+        t,
+        GuaranteedBest::Yes,
+        BelongsInFile::No,
+        [n, t]() {
+            auto m = std::make_shared<TestMatrix>(n, t);
+            for (int r=0; r < t; ++r) {
+                for (int i=0; i < n; ++i) {
+                    if ((i >> r) & 1) m->set(r, i);
+                }
+            }
+            return m;
+        }
+    );
 }
 
 std::shared_ptr<Strategy> worst_case_strategy(int n, GuaranteedBest gb)
@@ -108,16 +175,25 @@ std::shared_ptr<Strategy> worst_case_strategy(int n, GuaranteedBest gb)
         gb,
         BelongsInFile::No,
         [n]() {
-            std::vector<std::string> tests;
+            auto m = std::make_shared<TestMatrix>(n, n-1);
             for (int i=0; i < n-1; ++i) {
-                tests.push_back(std::string(n, '.'));
-                tests.back()[i] = '1';
+                m->set(i, i);
             }
-            return tests;
+            return m;
         }
     );
 }
 
+std::shared_ptr<Strategy> same_tests(std::shared_ptr<Strategy> orig)
+{
+    return std::make_shared<Strategy>(
+        orig->t,
+        GuaranteedBest::No,
+        BelongsInFile::No,
+        [orig]() { return orig->matrix(); }
+    );
+}
+
 std::shared_ptr<Strategy> test_last_animal_individually(int n, std::shared_ptr<Strategy> orig)
 {
     return std::make_shared<Strategy>(
@@ -125,52 +201,45 @@ std::shared_ptr<Strategy> test_last_animal_individually(int n, std::shared_ptr<S
         GuaranteedBest::No,
         BelongsInFile::No,
         [orig, n]() {
-            auto tests = orig->tests();
-            for (auto& test : tests) {
-                test.push_back('.');
+            const TestMatrix& old = *orig->matrix();
+            assert(old.n() == n);
+            auto m = std::make_shared<TestMatrix>(n+1, old.t() + 1);
+            for (int r=0; r < old.t(); ++r) {
+                std::copy(old.row(r), old.row(r) + (n + 63) / 64, m->row(r));
             }
-            tests.push_back(std::string(n, '.') + '1');
-            return tests;
+            m->set(old.t(), n);
+            return m;
         }
     );
 }
 
 std::shared_ptr<Strategy> replace_most_tested_animal(std::shared_ptr<Strategy> orig, bool with_wolf)
 {
-    auto tests = orig->tests();
-    const int n = tests[0].size();
-
-    std::vector<int> counts(n);
-    for (auto&& test : tests) {
-        for (int i=0; i < n; ++i) {
-            counts[i] += (test[i] == '1');
-        }
-    }
-    auto most_tested_idx = std::max_element(counts.begin(), counts.end()) - counts.begin();
-    int most_tested_count = counts[most_tested_idx];
+    int most_tested_idx, most_tested_count;
+    std::tie(most_tested_idx, most_tested_count) = orig->most_tested_animal();
     assert(most_tested_count >= 2);
 
-    if (with_wolf) {
-        tests.erase(
-            std::remove_if(
-                tests.begin(),
-                tests.end(),
-                [&](const auto& test){ return test[most_tested_idx] == '1'; }
-            ),
-            tests.end()
-        );
-    }
-
     return std::make_shared<Strategy>(
-        tests.size(),
+        with_wolf ? orig->t - most_tested_count : orig->t,
         GuaranteedBest::No,
         BelongsInFile::No,
-        [most_tested_idx, captured_tests = std::move(tests)]() {
-            auto tests = captured_tests;
-            for (auto&& test : tests) {
-                test.erase(test.begin() + most_tested_idx);
+        [orig, most_tested_idx, with_wolf]() {
+            const TestMatrix& old = *orig->matrix();
+            std::vector<int> rows;
+            for (int r=0; r < old.t(); ++r) {
+                if (!(with_wolf && old.get(r, most_tested_idx))) {
+                    rows.push_back(r);
+                }
             }
-            return tests;
+            auto m = std::make_shared<TestMatrix>(old.n() - 1, rows.size());
+            for (int r=0; r < (int)rows.size(); ++r) {
+                for (int i=0; i < old.n(); ++i) {
+                    if (i != most_tested_idx && old.get(rows[r], i)) {
+                        m->set(r, i - (i > most_tested_idx));
+                    }
+                }
+            }
+            return m;
         }
     );
 }
@@ -181,24 +250,54 @@ struct ND {
     bool operator<(const ND& rhs) const { return std::tie(d, n) < std::tie(rhs.d, rhs.n); }
 };
 
-bool overwrite_if_better(std::map<ND, std::shared_ptr<Strategy>>& m, int n, int d, std::shared_ptr<Strategy> strategy)
+// One T for each (n,d) with 0 <= d <= n <= max_n, stored row by row.
+template<class T>
+class Triangle {
+public:
+    explicit Triangle(int max_n) : max_n_(max_n), cells_(size_t(max_n + 1) * (max_n + 2) / 2) {}
+
+    int max_n() const { return max_n_; }
+    bool contains(int n, int d) const { return 0 <= d && d <= n && n <= max_n_; }
+    T& at(int n, int d) { assert(contains(n, d)); return cells_[size_t(n) * (n + 1) / 2 + d]; }
+    const T& at(int n, int d) const { assert(contains(n, d)); return cells_[size_t(n) * (n + 1) / 2 + d]; }
+
+private:
+    int max_n_;
+    std::vector<T> cells_;
+};
+
+using SolutionTable = Triangle<std::shared_ptr<Strategy>>;
+
+std::shared_ptr<Strategy> *find_solution(std::map<ND, std::shared_ptr<Strategy>>& m, int n, int d)
+{
+    auto it = m.find(ND{n,d});
+    return (it == m.end()) ? nullptr : &it->second;
+}
+
+std::shared_ptr<Strategy> *find_solution(SolutionTable& m, int n, int d)
+{
+    return m.contains(n, d) ? &m.at(n, d) : nullptr;
+}
+
+template<class Solutions>
+bool overwrite_if_better(Solutions& m, int n, int d, std::shared_ptr<Strategy> strategy)
 {
     assert(0 <= n);
     assert(0 <= d && d <= n);
-    auto it = m.find(ND{n,d});
-    if (it == m.end()) {
+    std::shared_ptr<Strategy> *current = find_solution(m, n, d);
+    if (current == nullptr) {
         return false;
-    } else if (strategy->isBetterThan(*it->second)) {
-        if (it->second->guaranteed_best != GuaranteedBest::No) {
-            printf("Replacing t(%d,%d)<=%d with t(%d,%d)<=%d\n", n,d,it->second->t,n,d,strategy->t);
+    } else if (strategy->isBetterThan(**current)) {
+        if ((*current)->guaranteed_best != GuaranteedBest::No) {
+            printf("Replacing t(%d,%d)<=%d with t(%d,%d)<=%d\n", n,d,(*current)->t,n,d,strategy->t);
         }
-        assert((it->second->guaranteed_best == GuaranteedBest::No) || !"found something better than the guaranteed best");
-        if (it->second->belongs_in_file == BelongsInFile::Yes) {
+        assert(((*current)->guaranteed_best == GuaranteedBest::No) || !"found something better than the guaranteed best");
+        if ((*current)->belongs_in_file == BelongsInFile::Yes) {
             // If this solution came from the file, we don't want to completely vanish it.
             // Replace it in the file with this better solution.
             strategy->belongs_in_file = BelongsInFile::Yes;
         }
-        it->second = strategy;
+        *current = strategy;
         return true;
     }
     return false;
@@ -211,56 +310,49 @@ void preserve_from_file(std::map<ND, std::shared_ptr<Strategy>>& m, int n, int d
     assert(overwritten);
 }
 
-void read_solutions_from_file(const char *filename, std::map<ND, std::shared_ptr<Strategy>>& m)
+void read_solutions_from_database(const char *filename, std::map<ND, std::shared_ptr<Strategy>>& m)
 {
-    std::ifstream infile(filename);
-    if (!infile.is_open()) {
-        throw std::runtime_error("Failed to open solution file");
+    auto db = std::make_shared<SolutionDb>();
+    if (!db->open(filename)) {
+        throw std::runtime_error("Failed to open solution database");
     }
-    std::string line;
-    bool seen_a_grid = false;
-    while (std::getline(infile, line)) {
-        if (line.compare(0, 2, "N=") == 0) {
-            int n, d, t, gb;
-            std::vector<std::string> tests;
-            int rc = std::sscanf(line.c_str(), "N=%d D=%d T=%d guaranteed_best=%d", &n, &d, &t, &gb);
-            assert(rc == 4 || !"input file contained malformed lines");
-            char nextch = infile.get();
-            infile.putback(nextch);
-            if (nextch == 'e') {
-                std::string word;
-                infile >> word;
-                assert(word == "emathgroup");
-                // This format comes from Zhao Hui Du, https://emathgroup.github.io/blog/two-poisoned-wine
-                tests.resize(t);
-                for (int i=0; i < n; ++i) {
-                    infile >> word;
-                    unsigned long long bits;
-                    rc = std::sscanf(word.c_str(), "%llx", &bits);
-                    assert(rc == 1 || !"emathgroup format contained malformed lines");
-                    assert(0 <= bits && bits < (1uLL << t));
-                    for (int r = 0; r < t; ++r) {
-                        tests[r].push_back((bits & 1) ? '1' : '.');
-                        bits >>= 1;
-                    }
-                }
-            } else {
-                for (int r=0; r < t; ++r) {
-                    std::getline(infile, line);
-                    assert(line.size() == n || !"input file contained malformed solution");
-                    tests.push_back(line);
+    // Read only the index; each matrix is copied out of the database when it's needed.
+    for (size_t i = 0; i < db->size(); ++i) {
+        const SolutionDbEntry& e = db->entry(i);
+        auto strategy = std::make_shared<Strategy>(
+            e.t,
+            e.guaranteed_best() ? GuaranteedBest::Yes : GuaranteedBest::No,
+            BelongsInFile::Yes,
+            [db, i]() {
+                const SolutionDbEntry& e = db->entry(i);
+                auto m = std::make_shared<TestMatrix>(e.n, e.t);
+                for (int r = 0; r < (int)e.t; ++r) {
+                    std::copy(db->row(i, r), db->row(i, r) + e.words_per_row(), m->row(r));
                 }
+                return m;
             }
-            auto strategy = std::make_shared<Strategy>(tests, gb ? GuaranteedBest::Yes : GuaranteedBest::No, BelongsInFile::Yes);
-            preserve_from_file(m, n, d, std::move(strategy));
-            seen_a_grid = true;
-        } else if (seen_a_grid && line != "") {
-            assert(!"input file contained malformed lines after the first grid");
-        }
+        );
+        preserve_from_file(m, e.n, e.d, std::move(strategy));
     }
 }
 
-void write_solutions_to_file(const char *filename, const std::map<ND, std::shared_ptr<Strategy>>& m)
+void read_solutions_from_file(const char *filename, std::map<ND, std::shared_ptr<Strategy>>& m)
+{
+    if (SolutionDb::is_solution_db(filename)) {
+        read_solutions_from_database(filename, m);
+        return;
+    }
+    bool opened = read_solution_file(filename, [&](SolutionFileEntry&& entry) {
+        auto strategy = std::make_shared<Strategy>(std::move(entry.tests), entry.guaranteed_best ? GuaranteedBest::Yes : GuaranteedBest::No, BelongsInFile::Yes);
+        preserve_from_file(m, entry.n, entry.d, std::move(strategy));
+    });
+    if (!opened) {
+        throw std::runtime_error("Failed to open solution file");
+    }
+}
+
+// Solutions from the file that are too big for the table are written back out unchanged.
+void write_solutions_to_file(const char *filename, const SolutionTable& m, const std::map<ND, std::shared_ptr<Strategy>>& from_file)
 {
     std::ofstream outfile(filename);
 
@@ -276,9 +368,8 @@ void write_solutions_to_file(const char *filename, const std::map<ND, std::share
     for (int n = 4; n <= max_n_to_print; ++n) {
         outfile << "    n=" << std::setw(2) << std::left << n << "   ";
         for (int d = 1; d < n; ++d) {
-            auto it = m.find(ND{n,d});
-            if (it != m.end()) {
-                int value = it->second->t;
+            if (m.contains(n, d)) {
+                int value = m.at(n, d)->t;
                 outfile << ' ' << std::setw(2) << std::right << value;
                 if (value == n-1) {
                     // Don't bother filling out the rest of this line.
@@ -292,76 +383,108 @@ void write_solutions_to_file(const char *filename, const std::map<ND, std::share
     }
     outfile << "\n\n";
 
-    for (const auto& kv : m) {
+    for (const auto& kv : from_file) {
         int n = kv.first.n;
         int d = kv.first.d;
-        const auto& strategy = kv.second;
-        if (strategy->belongs_in_file == BelongsInFile::Yes) {
-            if (n > 150) {
-                outfile << strategy->to_emathgroup_string(n, d) << '\n';
-            } else {
-                outfile << strategy->to_string(n, d) << '\n';
-            }
-        }
+        // If we found something better, it has taken the file's solution's place.
+        const auto& strategy = m.contains(n, d) ? m.at(n, d) : kv.second;
+        assert(strategy->belongs_in_file == BelongsInFile::Yes);
+        write_solution_entry(outfile, strategy->to_entry(n, d), n > 150);
     }
 }
 
-void add_easy_solutions(std::map<ND, std::shared_ptr<Strategy>>& m, int max_n)
+void add_easy_solutions(SolutionTable& m)
 {
-    for (int n=0; n <= max_n; ++n) {
+    // These depend only on n, so every d shares the same few strategies.
+    auto empty = empty_strategy();
+    for (int n=0; n <= m.max_n(); ++n) {
+        auto one_wolf = perfect_strategy_for_one_wolf(n);
+        auto worst_case = worst_case_strategy(n, GuaranteedBest::No);
+        auto worst_case_and_best = worst_case_strategy(n, GuaranteedBest::Yes);
         for (int d=0; d <= n; ++d) {
-            auto strategy =
-                (d == 0 || d == n) ? empty_strategy() :
-                (d == 1) ? perfect_strategy_for_one_wolf(n) :
-                (d >= n/2) ? worst_case_strategy(n, GuaranteedBest::Yes) :
-                worst_case_strategy(n, GuaranteedBest::No);
-            m.insert(std::make_pair(ND{n,d}, strategy));
+            m.at(n, d) =
+                (d == 0 || d == n) ? empty :
+                (d == 1) ? one_wolf :
+                (d >= n/2) ? worst_case_and_best :
+                worst_case;
         }
     }
 }
 
-template<class KeyValue>
-void add_solutions_derived_from(std::map<ND, std::shared_ptr<Strategy>>& m, const KeyValue& kv)
+// Whether a strategy with t tests that isn't guaranteed best could improve on what we have for (n,d).
+bool might_improve(const SolutionTable& m, int n, int d, int t)
 {
-    int n = kv.first.n;
-    int d = kv.first.d;
-    const std::shared_ptr<Strategy>& strategy = kv.second;
-    int t = strategy->t;
+    return m.contains(n, d) && t < m.at(n, d)->t;
+}
 
-    if (2 <= d && d < n && t < n-1) {
+// A derivation rule looks at the best strategy for (n,d) and offers
+// strategies for other cells, built out of it.
+using Offer = std::function<void(int n, int d, std::shared_ptr<Strategy>)>;
+using DerivationRule = std::function<void(const SolutionTable&, int n, int d, const std::shared_ptr<Strategy>&, const Offer&)>;
+
+std::vector<DerivationRule> derivation_rules()
+{
+    std::vector<DerivationRule> rules;
+    rules.push_back([](const SolutionTable& m, int n, int d, const std::shared_ptr<Strategy>& strategy, const Offer& offer) {
         // A solution to t(n-k,d) can be constructed from t(n,d): simply introduce k innocent sheep.
         // It's only worth doing if t < n-1.
-        auto smaller_strategy = replace_most_tested_animal(strategy, false);
-        if (overwrite_if_better(m, n-1, d, smaller_strategy)) {
-            add_solutions_derived_from(m, *m.find(ND{n-1, d}));
-        }
-        if (d-1 >= 2) {
-            auto smaller_strategy = replace_most_tested_animal(strategy, true);
-            if (overwrite_if_better(m, n-1, d-1, smaller_strategy)) {
-                add_solutions_derived_from(m, *m.find(ND{n-1, d-1}));
+        if (2 <= d && d < n && strategy->t < n-1) {
+            if (might_improve(m, n-1, d, strategy->t)) {
+                offer(n-1, d, replace_most_tested_animal(strategy, false));
+            }
+            // Or make the most-tested animal a wolf; that removes at least two tests.
+            if (d-1 >= 2 && might_improve(m, n-1, d-1, strategy->t - 2)) {
+                offer(n-1, d-1, replace_most_tested_animal(strategy, true));
             }
         }
-    }
-    if (2 < d && d < n-1 && t < n-1) {
+    });
+    rules.push_back([](const SolutionTable&, int n, int d, const std::shared_ptr<Strategy>& strategy, const Offer& offer) {
         // A solution for (n,d) also works for (n,d-1) except when d >= n-1.
-        std::shared_ptr<Strategy> r = std::make_shared<Strategy>(
-            strategy->t,
-            GuaranteedBest::No,
-            BelongsInFile::No,
-            [strategy]() { return strategy->tests(); }
-        );
-        if (overwrite_if_better(m, n, d-1, r)) {
-            add_solutions_derived_from(m, *m.find(ND{n, d-1}));
+        if (2 < d && d < n-1 && strategy->t < n-1) {
+            offer(n, d-1, same_tests(strategy));
         }
-    }
-    if (2 <= d && d < n && t < n-1) {
-        if (overwrite_if_better(m, n+1, d, test_last_animal_individually(n, strategy))) {
-            add_solutions_derived_from(m, *m.find(ND{n+1, d}));
+    });
+    rules.push_back([](const SolutionTable&, int n, int d, const std::shared_ptr<Strategy>& strategy, const Offer& offer) {
+        if (2 <= d && d < n && strategy->t < n-1) {
+            offer(n+1, d, test_last_animal_individually(n, strategy));
+        }
+    });
+    rules.push_back([](const SolutionTable&, int n, int d, const std::shared_ptr<Strategy>& strategy, const Offer& offer) {
+        if (strategy->t == n-1) {
+            offer(n+2, d+1, worst_case_strategy(n+2, strategy->guaranteed_best));
+        }
+    });
+    return rules;
+}
+
+// Apply the rules to each improved cell, and then to each cell that
+// that improved, and so on, until nothing improves. A cell that improves
+// again while it's still waiting its turn is visited just once.
+void add_derived_solutions(SolutionTable& m, const std::vector<DerivationRule>& rules, const std::vector<ND>& improved)
+{
+    Triangle<char> queued(m.max_n());
+    std::deque<ND> worklist;
+    auto enqueue = [&](int n, int d) {
+        if (!queued.at(n, d)) {
+            queued.at(n, d) = true;
+            worklist.push_back(ND{n, d});
         }
+    };
+    Offer offer = [&](int n, int d, std::shared_ptr<Strategy> strategy) {
+        if (overwrite_if_better(m, n, d, std::move(strategy))) {
+            enqueue(n, d);
+        }
+    };
+    for (const ND& nd : improved) {
+        enqueue(nd.n, nd.d);
     }
-    if (strategy->t == n-1) {
-        if (overwrite_if_better(m, n+2, d+1, worst_case_strategy(n+2, strategy->guaranteed_best))) {
-            add_solutions_derived_from(m, *m.find(ND{n+2, d+1}));
+    while (!worklist.empty()) {
+        ND nd = worklist.front();
+        worklist.pop_front();
+        queued.at(nd.n, nd.d) = false;
+        std::shared_ptr<Strategy> strategy = m.at(nd.n, nd.d);
+        for (const DerivationRule& rule : rules) {
+            rule(m, nd.n, nd.d, strategy, offer);
         }
     }
 }
@@ -371,15 +494,21 @@ int main(int argc, char **argv)
     const char *filename = "wolfy-out.txt";
     bool verify = false;
     bool verify_all = false;
+    DuplicateEngine engine = DuplicateEngine::Automatic;
+    int num_threads = std::max(1u, std::thread::hardware_concurrency());
     int i = 1;
     for (; argv[i] != nullptr && argv[i][0] == '-'; ++i) {
         if (strcmp(argv[i], "--help") == 0) {
-            puts("./wolfy [--file f.txt] [--verify] N D");
+            puts("./wolfy [--file f.txt] [--verify] [--engine E] [--threads T] N D");
             puts("");
             puts("Print the smallest known D-separable matrix with N columns.");
-            puts("  --file f.txt    Read best known solutions from this file");
+            puts("  --file f.txt    Read best known solutions from this file, either text or");
+            puts("                  a solution database made by ./sdb, which is never rewritten");
             puts("  --verify        Verbosely verify the solution that is printed");
             puts("  --verify-all    Verify every solution in the input file");
+            puts("  --engine E      Look for indistinguishable wolves with E: map, hash, or sort");
+            puts("                  (default: hash if it fits in half of RAM and T is 1, else sort)");
+            puts("  --threads T     Verify with T threads (default: one per CPU)");
             exit(0);
         } else if (strcmp(argv[i], "--file") == 0) {
             filename = argv[++i];
@@ -387,6 +516,19 @@ int main(int argc, char **argv)
             verify = true;
         } else if (strcmp(argv[i], "--verify-all") == 0) {
             verify_all = true;
+        } else if (strcmp(argv[i], "--engine") == 0 && argv[i+1] != nullptr) {
+            ++i;
+            for (DuplicateEngine e : { DuplicateEngine::Map, DuplicateEngine::HashSet, DuplicateEngine::Sort }) {
+                if (strcmp(argv[i], duplicate_engine_name(e)) == 0) {
+                    engine = e;
+                }
+            }
+            if (engine == DuplicateEngine::Automatic) {
+                printf("Unrecognized engine '%s'; --help for help\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strcmp(argv[i], "--threads") == 0 && argv[i+1] != nullptr) {
+            num_threads = std::max(1, atoi(argv[++i]));
         } else {
             printf("Unrecognized option '%s'; --help for help\n", argv[i]);
             exit(EXIT_FAILURE);
@@ -410,10 +552,10 @@ int main(int argc, char **argv)
 
     if (verify_all) {
         for (auto&& kv : solutions_from_file) {
-            VerifyStrategyResult r = verify_strategy(kv.first.n, kv.first.d, kv.second->tests());
+            VerifyStrategyResult r = verify_strategy(kv.first.n, kv.first.d, kv.second->tests(), engine, num_threads);
             if (!r.success) {
                 printf("INVALID! (This should never happen unless the solution file is bad.)\n");
-                printf("%s\n", kv.second->to_string(n, d).c_str());
+                printf("%s", kv.second->to_string(kv.first.n, kv.first.d).c_str());
                 printf("These two wolf arrangements cannot be distinguished:\n");
                 printf("%s\n", r.w1.c_str());
                 printf("%s\n", r.w2.c_str());
@@ -421,22 +563,29 @@ int main(int argc, char **argv)
         }
     }
 
-    std::map<ND, std::shared_ptr<Strategy>> all_solutions;
-    add_easy_solutions(all_solutions, n + 100);
+    SolutionTable all_solutions(n + 100);
+    add_easy_solutions(all_solutions);
+    std::vector<ND> improved;
     for (auto&& kv : solutions_from_file) {
-        preserve_from_file(all_solutions, kv.first.n, kv.first.d, kv.second);
-        add_solutions_derived_from(all_solutions, kv);
+        if (all_solutions.contains(kv.first.n, kv.first.d)) {
+            bool overwritten = overwrite_if_better(all_solutions, kv.first.n, kv.first.d, kv.second);
+            assert(overwritten);
+            improved.push_back(kv.first);
+        }
     }
+    add_derived_solutions(all_solutions, derivation_rules(), improved);
 
-    write_solutions_to_file("wolfy-out.txt", all_solutions);
+    if (!SolutionDb::is_solution_db(filename)) {
+        write_solutions_to_file("wolfy-out.txt", all_solutions, solutions_from_file);
+    }
 
-    std::shared_ptr<Strategy> strategy = all_solutions.at(ND{n, d});
+    std::shared_ptr<Strategy> strategy = all_solutions.at(n, d);
     auto tests = strategy->tests();
 
     if (verify) {
         printf("Candidate is\n");
-        printf("%s\n", strategy->to_string(n, d).c_str());
-        VerifyStrategyResult r = verify_strategy(n, d, tests);
+        printf("%s", strategy->to_string(n, d).c_str());
+        VerifyStrategyResult r = verify_strategy(n, d, tests, engine, num_threads);
         if (r.success) {
             printf("Verified. This is a solution for t(%d, %d) <= %zu.\n", n, d, tests.size());
         } else {
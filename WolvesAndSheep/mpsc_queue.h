@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+// A multiple-producer, single-consumer queue (Dmitry Vyukov's design).
+// push() never takes a lock or waits for another thread: it's one atomic
+// exchange plus one store. pop() may be called by only one thread at a time;
+// it returns false if the queue is empty, or if the newest push is still
+// halfway done, in which case the consumer just tries again later.
+template<class T>
+class MpscQueue {
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        T value;
+    };
+    std::atomic<Node*> head_;  // the most recently pushed node
+    Node *tail_;               // a dummy node, followed by the oldest one
+
+public:
+    MpscQueue() {
+        Node *stub = new Node;
+        head_.store(stub, std::memory_order_relaxed);
+        tail_ = stub;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue() {
+        T value;
+        while (pop(value)) {}
+        delete tail_;
+    }
+
+    void push(T value) {
+        Node *node = new Node;
+        node->value = std::move(value);
+        Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    bool pop(T& value) {
+        Node *next = tail_->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            return false;
+        }
+        value = std::move(next->value);
+        delete tail_;
+        tail_ = next;
+        return true;
+    }
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "solution_file.h"
+
+// A binary solution file, for libraries too big to parse on every run.
+// Every field is in the host's byte order:
+//
+//   header    the magic "WOLFYSDB", then uint32 version and uint32 count
+//   index     count SolutionDbEntry, sorted by (d, n)
+//   matrices  for each entry, at its offset: t rows of (n+63)/64 uint64
+//             words; bit i of row r is set if test r involves animal i
+//
+// The file is mmapped, so opening it reads only the header, looking up
+// an (n,d) is a binary search of the index, and an entry's matrix is
+// paged in only when it's used.
+
+struct SolutionDbEntry {
+    uint32_t n, d, t;
+    uint32_t flags;   // bit 0: guaranteed_best
+    uint64_t offset;  // of the matrix, from the start of the file
+
+    bool guaranteed_best() const { return flags & 1; }
+    int words_per_row() const { return (n + 63) / 64; }
+};
+static_assert(sizeof(SolutionDbEntry) == 24, "SolutionDbEntry must have no padding");
+
+class SolutionDb {
+public:
+    static const char *magic() { return "WOLFYSDB"; }
+    static constexpr uint32_t version = 1;
+    static constexpr size_t header_size = 16;
+
+    SolutionDb() = default;
+    SolutionDb(const SolutionDb&) = delete;
+    SolutionDb& operator=(const SolutionDb&) = delete;
+    ~SolutionDb() { if (data_ != nullptr) munmap(const_cast<char*>(data_), size_); }
+
+    // Return false if the file can't be opened, or isn't a solution database of this version.
+    bool open(const char *filename) {
+        assert(data_ == nullptr);
+        int fd = ::open(filename, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        bool ok = (fstat(fd, &st) == 0 && st.st_size >= (off_t)header_size);
+        if (ok) {
+            size_ = st.st_size;
+            void *p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            ok = (p != MAP_FAILED);
+            data_ = ok ? static_cast<const char*>(p) : nullptr;
+        }
+        close(fd);
+        if (ok) {
+            uint32_t v;
+            std::memcpy(&v, data_ + 8, 4);
+            std::memcpy(&count_, data_ + 12, 4);
+            ok = (std::memcmp(data_, magic(), 8) == 0 && v == version && header_size + count_ * sizeof(SolutionDbEntry) <= size_);
+        }
+        if (!ok && data_ != nullptr) {
+            munmap(const_cast<char*>(data_), size_);
+            data_ = nullptr;
+        }
+        return ok;
+    }
+
+    static bool is_solution_db(const char *filename) {
+        char buffer[8] = {};
+        FILE *fp = fopen(filename, "rb");
+        if (fp == nullptr) return false;
+        bool result = (fread(buffer, 1, 8, fp) == 8 && std::memcmp(buffer, magic(), 8) == 0);
+        fclose(fp);
+        return result;
+    }
+
+    size_t size() const { return count_; }
+
+    const SolutionDbEntry& entry(size_t i) const {
+        assert(i < count_);
+        return reinterpret_cast<const SolutionDbEntry*>(data_ + header_size)[i];
+    }
+
+    // The index of the entry for (n,d), or -1 if there isn't one.
+    long find(int n, int d) const {
+        const SolutionDbEntry *first = reinterpret_cast<const SolutionDbEntry*>(data_ + header_size);
+        const SolutionDbEntry *last = first + count_;
+        auto key = [](const SolutionDbEntry& e) { return std::make_tuple(e.d, e.n); };
+        auto it = std::lower_bound(first, last, std::make_tuple(uint32_t(d), uint32_t(n)), [&](const SolutionDbEntry& e, const auto& k) {
+            return key(e) < k;
+        });
+        return (it != last && key(*it) == std::make_tuple(uint32_t(d), uint32_t(n))) ? (it - first) : -1;
+    }
+
+    const uint64_t *row(size_t i, int r) const {
+        const SolutionDbEntry& e = entry(i);
+        assert(0 <= r && r < (int)e.t);
+        assert(e.offset + uint64_t(e.t) * e.words_per_row() * 8 <= size_);
+        return reinterpret_cast<const uint64_t*>(data_ + e.offset) + size_t(r) * e.words_per_row();
+    }
+
+    SolutionFileEntry read(size_t i) const {
+        const SolutionDbEntry& e = entry(i);
+        SolutionFileEntry result { int(e.n), int(e.d), int(e.t), e.guaranteed_best(), {} };
+        for (int r = 0; r < (int)e.t; ++r) {
+            const uint64_t *bits = row(i, r);
+            std::string test(e.n, '.');
+            for (int c = 0; c < (int)e.n; ++c) {
+                if ((bits[c / 64] >> (c % 64)) & 1) test[c] = '1';
+            }
+            result.tests.push_back(std::move(test));
+        }
+        return result;
+    }
+
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    uint32_t count_ = 0;
+};
+
+// Write the entries, which must all have different (n,d), as a solution database.
+inline bool write_solution_db(const char *filename, std::vector<SolutionFileEntry> entries)
+{
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+        return std::tie(a.d, a.n) < std::tie(b.d, b.n);
+    });
+    std::vector<SolutionDbEntry> index;
+    uint64_t offset = SolutionDb::header_size + entries.size() * sizeof(SolutionDbEntry);
+    for (const SolutionFileEntry& e : entries) {
+        assert(index.empty() || index.back().n != uint32_t(e.n) || index.back().d != uint32_t(e.d));
+        index.push_back(SolutionDbEntry{ uint32_t(e.n), uint32_t(e.d), uint32_t(e.t), e.guaranteed_best ? 1u : 0u, offset });
+        offset += uint64_t(e.t) * index.back().words_per_row() * 8;
+    }
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == nullptr) {
+        return false;
+    }
+    uint32_t header[2] = { SolutionDb::version, uint32_t(entries.size()) };
+    fwrite(SolutionDb::magic(), 1, 8, fp);
+    fwrite(header, sizeof header, 1, fp);
+    fwrite(index.data(), sizeof(SolutionDbEntry), index.size(), fp);
+    for (const SolutionFileEntry& e : entries) {
+        std::vector<uint64_t> bits((e.n + 63) / 64);
+        for (const std::string& test : e.tests) {
+            assert((int)test.size() == e.n);
+            std::fill(bits.begin(), bits.end(), 0);
+            for (int c = 0; c < e.n; ++c) {
+                if (test[c] == '1') bits[c / 64] |= uint64_t(1) << (c % 64);
+            }
+            fwrite(bits.data(), sizeof(uint64_t), bits.size(), fp);
+        }
+    }
+    return (fclose(fp) == 0);
+}
+
+// Call f(entry) for each strategy in either kind of solution file.
+// Return false if the file can't be opened.
+template<class F>
+bool read_any_solution_file(const char *filename, const F& f)
+{
+    if (SolutionDb::is_solution_db(filename)) {
+        SolutionDb db;
+        if (!db.open(filename)) {
+            return false;
+        }
+        for (size_t i = 0; i < db.size(); ++i) {
+            f(db.read(i));
+        }
+        return true;
+    }
+    return read_solution_file(filename, f);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cassert>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// One strategy from a solution file such as wolfy-out.txt. Each entry starts
+// with a line "N=%d D=%d T=%d guaranteed_best=%d", followed either by T lines
+// of N characters ('1' where that animal is in that test), or by the word
+// "emathgroup" and N hex words, one per animal, where bit r means the animal
+// is in test r.
+struct SolutionFileEntry {
+    int n, d, t;
+    bool guaranteed_best;
+    std::vector<std::string> tests;
+};
+
+// Call f(entry) for each strategy in the file, in order.
+// Return false if the file can't be opened.
+template<class F>
+bool read_solution_file(const char *filename, const F& f)
+{
+    std::ifstream infile(filename);
+    if (!infile.is_open()) {
+        return false;
+    }
+    std::string line;
+    bool seen_a_grid = false;
+    while (std::getline(infile, line)) {
+        if (line.compare(0, 2, "N=") == 0) {
+            SolutionFileEntry entry;
+            int gb;
+            int rc = std::sscanf(line.c_str(), "N=%d D=%d T=%d guaranteed_best=%d", &entry.n, &entry.d, &entry.t, &gb);
+            assert(rc == 4 || !"input file contained malformed lines");
+            entry.guaranteed_best = (gb != 0);
+            const int n = entry.n;
+            const int t = entry.t;
+            char nextch = infile.get();
+            infile.putback(nextch);
+            if (nextch == 'e') {
+                std::string word;
+                infile >> word;
+                assert(word == "emathgroup");
+                // This format comes from Zhao Hui Du, https://emathgroup.github.io/blog/two-poisoned-wine
+                entry.tests.resize(t);
+                for (int i=0; i < n; ++i) {
+                    infile >> word;
+                    for (int r = 0; r < t; ++r) {
+                        entry.tests[r].push_back('.');
+                    }
+                    // The last hex digit holds tests 0 through 3, and so on.
+                    for (int k = 0; k < (int)word.size(); ++k) {
+                        char ch = word[word.size() - 1 - k];
+                        int digit = std::isdigit(ch) ? (ch - '0') : (std::tolower(ch) - 'a' + 10);
+                        assert((std::isxdigit(ch) && digit < 16) || !"emathgroup format contained malformed lines");
+                        for (int b = 0; b < 4; ++b) {
+                            if ((digit >> b) & 1) {
+                                assert(4*k + b < t || !"emathgroup format contained a test that doesn't exist");
+                                entry.tests[4*k + b][i] = '1';
+                            }
+                        }
+                    }
+                }
+            } else {
+                for (int r=0; r < t; ++r) {
+                    std::getline(infile, line);
+                    assert(line.size() == n || !"input file contained malformed solution");
+                    entry.tests.push_back(line);
+                }
+            }
+            f(std::move(entry));
+            seen_a_grid = true;
+        } else if (seen_a_grid && line != "") {
+            assert(!"input file contained malformed lines after the first grid");
+        }
+    }
+    return true;
+}
+
+// Write the entry the way read_solution_file reads it, followed by a blank
+// line. The emathgroup format wraps its hex words at 75 columns.
+inline void write_solution_entry(std::ostream& out, const SolutionFileEntry& entry, bool emathgroup)
+{
+    out << "N=" << entry.n << " D=" << entry.d << " T=" << entry.t;
+    out << " guaranteed_best=" << (entry.guaranteed_best ? '1' : '0') << '\n';
+    if (emathgroup) {
+        // This format comes from Zhao Hui Du, https://emathgroup.github.io/blog/two-poisoned-wine
+        out << "emathgroup";
+        int wordwrap = 10;
+        for (int c=0; c < entry.n; ++c) {
+            std::string hexbits;
+            for (int r = (entry.t - 1) / 4 * 4; r >= 0; r -= 4) {
+                int digit = 0;
+                for (int b = 3; b >= 0; --b) {
+                    digit = 2*digit + (r + b < entry.t && entry.tests[r + b][c] == '1');
+                }
+                if (digit != 0 || !hexbits.empty()) {
+                    hexbits += "0123456789abcdef"[digit];
+                }
+            }
+            if (hexbits.empty()) {
+                hexbits = "0";
+            }
+            if (wordwrap + 1 + hexbits.size() > 75) {
+                out << "\n" << hexbits;
+                wordwrap = hexbits.size();
+            } else {
+                out << " " << hexbits;
+                wordwrap += 1 + hexbits.size();
+            }
+        }
+        out << "\n";
+    } else {
+        for (auto&& test : entry.tests) {
+            out << test << '\n';
+        }
+    }
+    out << '\n';
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+// A bounded-memory set of search positions known to be hopeless, shared
+// lock-free among all the threads that are searching.
+//
+// Each slot holds a 56-bit fingerprint of a position in its high bits and,
+// in its low 8 bits, the number of remaining tests with which that position
+// is known to be hopeless. (A position that can't be completed in r tests
+// certainly can't be completed in fewer.) A zero slot is empty.
+// When all the slots a position can live in are full, we evict the one
+// with the fewest remaining tests, i.e. probably the cheapest to re-search.
+// Losing an entry costs us only time, never correctness.
+//
+class TranspositionTable {
+public:
+    explicit TranspositionTable(size_t bytes) {
+        size_t n = 1024;
+        while (n * 2 * sizeof(std::atomic<uint64_t>) <= bytes) {
+            n *= 2;
+        }
+        slots_.reset(new std::atomic<uint64_t>[n]);
+        for (size_t i = 0; i < n; ++i) {
+            slots_[i].store(0, std::memory_order_relaxed);
+        }
+        mask_ = n - 1;
+    }
+
+    size_t size_in_bytes() const { return (mask_ + 1) * sizeof(std::atomic<uint64_t>); }
+
+    bool is_hopeless(uint64_t hash, int remaining) const {
+        const uint64_t fp = fingerprint(hash);
+        for (int p = 0; p < kProbes; ++p) {
+            uint64_t v = slots_[(hash + p) & mask_].load(std::memory_order_relaxed);
+            if ((v & ~kRemainingMask) == fp && int(v & kRemainingMask) >= remaining) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void mark_hopeless(uint64_t hash, int remaining) {
+        const uint64_t fp = fingerprint(hash);
+        const uint64_t desired = fp | uint64_t(remaining);
+        size_t victim = hash & mask_;
+        uint64_t victim_value = ~uint64_t(0);
+        for (int p = 0; p < kProbes; ++p) {
+            std::atomic<uint64_t>& slot = slots_[(hash + p) & mask_];
+            uint64_t v = slot.load(std::memory_order_relaxed);
+            while (v == 0 || (v & ~kRemainingMask) == fp) {
+                if (v != 0 && int(v & kRemainingMask) >= remaining) {
+                    return;  // we already knew this much
+                }
+                if (slot.compare_exchange_weak(v, desired, std::memory_order_relaxed)) {
+                    return;
+                }
+            }
+            if ((v & kRemainingMask) < (victim_value & kRemainingMask)) {
+                victim = (hash + p) & mask_;
+                victim_value = v;
+            }
+        }
+        slots_[victim].store(desired, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr int kProbes = 4;
+    static constexpr uint64_t kRemainingMask = 0xFF;
+
+    static uint64_t fingerprint(uint64_t hash) {
+        // Bit 8 is forced on, so that no fingerprint looks like an empty slot.
+        return (hash & ~kRemainingMask) | 0x100;
+    }
+
+    std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+    size_t mask_;
+};
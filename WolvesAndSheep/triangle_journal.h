@@ -0,0 +1,151 @@
+#pragma once
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include "wolves.h"
+
+// A journal of what ./mt has learned about the triangle t(n,k). It's a text
+// file of one fact per line, each the outcome of some finished search:
+//
+//     lower n k t            t(n,k) >= t
+//     upper n k t [tests]    t(n,k) <= t
+//
+// An "upper" line from a search that found a solution carries that solution
+// as a witness: one hex number per test, whose bit s is set if the test
+// involves sheep s. The bounds that follow from these facts aren't recorded;
+// we rederive them on loading. Since every line is true on its own, merging
+// two runs' journals is as easy as concatenating them.
+//
+// Each line goes to the file in a single O_APPEND write, followed by fsync,
+// so a crash can lose at most a partial last line, which we ignore on loading.
+
+// Test i of a solution, as a hex number whose bit s is set if the test involves sheep s.
+inline std::string test_as_hex(const NktResult& result, int i)
+{
+    std::string hex;
+    bool leading = true;
+    for (int w = (result.n + 63) / 64; w-- != 0; ) {
+        char buffer[20];
+        snprintf(buffer, sizeof buffer, leading ? "%llx" : "%016llx", (unsigned long long)result.tests[i][w]);
+        if (!leading || result.tests[i][w] != 0 || w == 0) {
+            hex += buffer;
+            leading = false;
+        }
+    }
+    return hex;
+}
+
+// The inverse of test_as_hex. Returns false if "hex" isn't a hex number of at most n bits.
+inline bool test_from_hex(const std::string& hex, NktResult& result, int i)
+{
+    const size_t digits_per_word = 16;
+    const int words = (result.n + 63) / 64;
+    if (hex.empty() || hex.size() > words * digits_per_word) {
+        return false;
+    }
+    for (int w = 0; w < words; ++w) {
+        result.tests[i][w] = 0;
+    }
+    for (size_t d = 0; d < hex.size(); ++d) {
+        // Digit d from the right is bits 4d through 4d+3.
+        char c = hex[hex.size() - 1 - d];
+        int v = (c >= '0' && c <= '9') ? (c - '0') : (c >= 'a' && c <= 'f') ? (c - 'a' + 10) : -1;
+        if (v < 0) {
+            return false;
+        }
+        result.tests[i][d / digits_per_word] |= uint64_t(v) << (4 * (d % digits_per_word));
+    }
+    return (result.n % 64 == 0) || (result.tests[i][words - 1] >> (result.n % 64)) == 0;
+}
+
+class TriangleJournal {
+public:
+    ~TriangleJournal() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    // Call f(is_upper, n, k, t) for each fact in the file; return how many
+    // there were, or -1 if the file can't be read.
+    template<class F>
+    static int load(const std::string& filename, const F& f) {
+        FILE *fp = fopen(filename.c_str(), "r");
+        if (fp == nullptr) {
+            return -1;
+        }
+        int count = 0;
+        char line[4096];
+        while (fgets(line, sizeof line, fp) != nullptr) {
+            if (strchr(line, '\n') == nullptr) {
+                // A truncated last line, or garbage; skip it.
+                int ch;
+                while ((ch = getc(fp)) != EOF && ch != '\n') {}
+                continue;
+            }
+            char kind[8];
+            int n, k, t;
+            if (sscanf(line, "%7s %d %d %d", kind, &n, &k, &t) != 4 || n < 0 || n >= kMaxSheep || k < 0 || k > n || t < 0) {
+                continue;
+            }
+            if (strcmp(kind, "lower") == 0) {
+                f(false, n, k, t);
+                count += 1;
+            } else if (strcmp(kind, "upper") == 0) {
+                f(true, n, k, t);
+                count += 1;
+            }
+        }
+        fclose(fp);
+        return count;
+    }
+
+    bool open_for_append(const std::string& filename) {
+        fd_ = ::open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+        if (fd_ < 0) {
+            return false;
+        }
+        // If we crashed in the middle of a line last time, finish it off,
+        // so that our first line doesn't get glued onto it.
+        FILE *fp = fopen(filename.c_str(), "r");
+        if (fp != nullptr) {
+            if (fseek(fp, -1, SEEK_END) == 0 && getc(fp) != '\n') {
+                append_line("\n");
+            }
+            fclose(fp);
+        }
+        return true;
+    }
+
+    bool is_open() const { return fd_ >= 0; }
+
+    void append_lower(int n, int k, int t) {
+        append_line("lower " + std::to_string(n) + " " + std::to_string(k) + " " + std::to_string(t) + "\n");
+    }
+
+    void append_upper(const NktResult& result) {
+        std::string line = "upper " + std::to_string(result.n) + " " + std::to_string(result.k) + " " + std::to_string(result.t);
+        if (result.status == NktStatus::Found) {
+            for (int i = 0; i < result.num_tests; ++i) {
+                line += " " + test_as_hex(result, i);
+            }
+        }
+        append_line(line + "\n");
+    }
+
+private:
+    void append_line(const std::string& line) {
+        if (fd_ < 0) {
+            return;
+        }
+        if (write(fd_, line.data(), line.size()) != ssize_t(line.size()) || fsync(fd_) != 0) {
+            fprintf(stderr, "Failed to append to the journal\n");
+        }
+    }
+
+    int fd_ = -1;
+};
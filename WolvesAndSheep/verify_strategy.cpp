@@ -1,77 +1,81 @@
 
 #include "verify_strategy.h"
+#include "combinations.h"
 
 #include <cassert>
-#include <limits>
-#include <map>
+#include <cstdint>
 #include <string>
 #include <vector>
 
-using Int = unsigned long long;
-
-struct TestResults64 {
-    uint64_t data_;
-    void push_back(bool b) { data_ <<= 1; data_ |= uint64_t(b); }
-    friend bool operator<(const TestResults64& a, const TestResults64& b) { return a.data_ < b.data_; }
-};
+namespace {
 
-struct TestResults128 {
-    unsigned __int128 data_;
-    void push_back(bool b) { data_ <<= 1; data_ |= (unsigned __int128)(b); }
-    friend bool operator<(const TestResults128& a, const TestResults128& b) { return a.data_ < b.data_; }
-};
+using Int = unsigned long long;
 
+// The outcome of every test, one bit per test. A test comes back wolfy
+// if any wolf is in it, so the outcome for a whole arrangement of wolves
+// is the OR of each wolf's column of the test matrix.
 struct TestResultsBig {
-    std::vector<bool> data_;
-    void push_back(bool b) { data_.push_back(b); }
+    std::vector<uint64_t> data_;
+    TestResultsBig() = default;
+    explicit TestResultsBig(int words) : data_(words) {}
+    friend TestResultsBig operator|(const TestResultsBig& a, const TestResultsBig& b) {
+        TestResultsBig r = a;
+        for (size_t i = 0; i < r.data_.size(); ++i) r.data_[i] |= b.data_[i];
+        return r;
+    }
     friend bool operator<(const TestResultsBig& a, const TestResultsBig& b) { return a.data_ < b.data_; }
+    friend bool operator==(const TestResultsBig& a, const TestResultsBig& b) { return a.data_ == b.data_; }
 };
 
+void set_bit(uint64_t& r, int i) { r |= uint64_t(1) << i; }
+void set_bit(unsigned __int128& r, int i) { r |= (unsigned __int128)(1) << i; }
+void set_bit(TestResultsBig& r, int i) { r.data_[i / 64] |= uint64_t(1) << (i % 64); }
+
+// All the arrangements of d wolves among n animals, in "revolving door"
+// order (Knuth's Algorithm 7.2.1.3R): each arrangement differs from the
+// previous one by a single wolf leaving and a single wolf arriving, and
+// usually only c_[0] or c_[1] changes.
 struct WolfArrangement {
-    std::vector<int> v_;
+    std::vector<int> c_;  // the wolves, in increasing order, followed by n
 
-    static WolfArrangement from_index(int n, int d, int id) {
-        WolfArrangement result;
-        for (int i=0; i < d; ++i) result.v_.push_back(i);
-        for (int i=0; i < id; ++i) result.increment(n);
-        return result;
+    explicit WolfArrangement(int n, int d) {
+        for (int i=0; i < d; ++i) c_.push_back(i);
+        c_.push_back(n);
     }
 
-    bool animal_is_wolf(int i) const {
-        for (int j : v_) if (i == j) return true;
-        return false;
-    }
+    int d() const { return c_.size() - 1; }
 
-    template<class F>
-    bool test_is_wolfy(const F& test_contains_animal, int t) const {
-        for (int i : v_) {
-            if (test_contains_animal(t, i)) return true;
-        }
+    bool animal_is_wolf(int i) const {
+        for (int j=0; j < d(); ++j) if (i == c_[j]) return true;
         return false;
     }
 
-    void increment(int n) {
-        // Increment the first possible animal index,
-        // and then reset all the previous ones.
-        const int d = v_.size();
-        for (int i=0; i < d-1; ++i) {
-            if (v_[i] + 1 < v_[i+1]) {
-                v_[i] += 1;
-                for (int j = 0; j < i; ++j) {
-                    v_[j] = j;
+    // Step to the next arrangement and return the highest index into c_ that
+    // changed; every index below it may have changed too. Return -1 after the
+    // last arrangement. (Knuth numbers c from 1; our c_[j-1] is his c_j.)
+    int increment() {
+        const int t = d();
+        if (t == 0) return -1;
+        if (t % 2 == 1 && c_[0] + 1 < c_[1]) { c_[0] += 1; return 0; }
+        if (t % 2 == 0 && c_[0] > 0) { c_[0] -= 1; return 0; }
+        for (int j = 2; j <= t; ++j) {
+            if ((j + t) % 2 == 1) {
+                // Try to decrease c_j; at this point c_j = c_{j-1} + 1.
+                if (c_[j-1] >= j) {
+                    c_[j-1] = c_[j-2];
+                    c_[j-2] = j - 2;
+                    return j - 1;
+                }
+            } else {
+                // Try to increase c_j; at this point c_{j-1} = j - 2.
+                if (c_[j-1] + 1 < c_[j]) {
+                    c_[j-2] = c_[j-1];
+                    c_[j-1] += 1;
+                    return j - 1;
                 }
-                return;
-            }
-        }
-        if (v_[d-1] + 1 < n) {
-            v_[d-1] += 1;
-            for (int j = 0; j < d-1; ++j) {
-                v_[j] = j;
             }
-            return;
         }
-        // Otherwise, increment is impossible.
-        assert(false);
+        return -1;
     }
 
     std::string to_string(int n) const {
@@ -83,68 +87,78 @@ struct WolfArrangement {
     }
 };
 
-static Int add_check(Int a, Int b) {
-    assert(0 <= a);
-    assert(0 <= b && b <= std::numeric_limits<Int>::max() - a);
-    return a + b;
-}
-
-static Int choose(int n, int k) {
-    if (k > n) return Int(0);
-    if (k == 0 || k == n) return Int(1);
-    if (k == 1 || k == n-1) return Int(n);
-    return add_check(choose(n-1, k), choose(n-1, k-1));
-}
-
 template<class TestResults>
-VerifyStrategyResult verify_strategy_impl(int n, int d, const std::vector<std::string>& tests)
+VerifyStrategyResult verify_strategy_impl(int n, int d, const std::vector<std::string>& tests, DuplicateEngine engine, int num_threads, TestResults zero)
 {
-    const Int n_choose_d = choose(n, d);
     const int t = tests.size();
     for (auto&& test : tests) {
         assert(test.size() == n);
     }
 
-    WolfArrangement wolves = WolfArrangement::from_index(n, d, 0);
-    std::map<TestResults, int> test_results_map;
-
-    auto run_tests = [&]() {
-        auto test_contains_animal = [&](int ti, int ni) {
-            return tests[ti][ni] == '1';
-        };
-        TestResults r;
-        for (int ti=0; ti < t; ++ti) {
-            r.push_back(wolves.test_is_wolfy(test_contains_animal, ti));
+    // column[i] is the set of tests that animal i is in.
+    std::vector<TestResults> column(n, zero);
+    for (int ti=0; ti < t; ++ti) {
+        for (int ni=0; ni < n; ++ni) {
+            if (tests[ti][ni] == '1') set_bit(column[ni], ti);
         }
-        return r;
+    }
+
+    const BinomialTable choose(n, d);
+    const Int count = choose(n, d);
+    auto from_rank = [&](Int rank) {
+        WolfArrangement wolves(n, d);
+        revolving_door_unrank(rank, n, d, wolves.c_.data(), choose);
+        return wolves;
     };
 
-    test_results_map.insert(std::make_pair(run_tests(), 0));
-    for (Int id=1; id < n_choose_d; ++id) {
-        wolves.increment(n);
-        auto ii = test_results_map.insert(std::make_pair(run_tests(), id));
-        if (ii.second == false) {
-            int old_id = ii.first->second;
-            VerifyStrategyResult result;
-            result.success = false;
-            result.w1 = WolfArrangement::from_index(n, d, old_id).to_string(n);
-            result.w2 = wolves.to_string(n);
-            return result;
+    // Call f(wolves, results) for the arrangements of ranks [begin, end), until it returns false.
+    // above[j] is the OR of the columns of wolves c_[j] through c_[d-1],
+    // so that when only the first few wolves move, we redo only their part.
+    auto for_each_arrangement = [&](Int begin, Int end, const auto& f) {
+        if (begin == end) return;
+        WolfArrangement wolves = from_rank(begin);
+        std::vector<TestResults> above(d + 1, zero);
+        int changed = d - 1;
+        for (Int id = begin; id < end; ++id) {
+            for (int j = changed; j >= 0; --j) {
+                above[j] = above[j+1] | column[wolves.c_[j]];
+            }
+            if (!f(wolves, above[0])) return;
+            changed = wolves.increment();
         }
+    };
+
+    const size_t budget = default_duplicate_memory_budget();
+    if (engine == DuplicateEngine::Automatic) {
+        engine = choose_duplicate_engine<TestResults>(count, budget, num_threads);
     }
+    auto generate = [&](Int begin, Int end, const auto& emit) {
+        for_each_arrangement(begin, end, [&](const WolfArrangement&, const TestResults& r) { return emit(r); });
+    };
+    TestResults dup;
+    bool found = find_duplicate(engine, count, budget, num_threads, generate, &dup);
 
     VerifyStrategyResult result;
-    result.success = true;
+    result.success = !found;
+    if (found) {
+        // Go back and find the two arrangements that gave those results.
+        std::vector<Int> ranks = find_ranks_of(dup, count, num_threads, generate);
+        assert(ranks.size() == 2);
+        result.w1 = from_rank(ranks[0]).to_string(n);
+        result.w2 = from_rank(ranks[1]).to_string(n);
+    }
     return result;
 }
 
-VerifyStrategyResult verify_strategy(int n, int d, const std::vector<std::string>& tests)
+} // namespace
+
+VerifyStrategyResult verify_strategy(int n, int d, const std::vector<std::string>& tests, DuplicateEngine engine, int num_threads)
 {
     if (tests.size() <= 64) {
-        return verify_strategy_impl<TestResults64>(n, d, tests);
+        return verify_strategy_impl<uint64_t>(n, d, tests, engine, num_threads, 0);
     } else if (tests.size() <= 128) {
-        return verify_strategy_impl<TestResults128>(n, d, tests);
+        return verify_strategy_impl<unsigned __int128>(n, d, tests, engine, num_threads, 0);
     } else {
-        return verify_strategy_impl<TestResultsBig>(n, d, tests);
+        return verify_strategy_impl<TestResultsBig>(n, d, tests, engine, num_threads, TestResultsBig((tests.size() + 63) / 64));
     }
 }
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include "duplicate_finder.h"
 
 struct VerifyStrategyResult {
     bool success;
@@ -10,4 +11,7 @@ struct VerifyStrategyResult {
     std::string w2;
 };
 
-VerifyStrategyResult verify_strategy(int n, int d, const std::vector<std::string>& tests);
+// Check every arrangement of d wolves among n animals. With more than one
+// thread, the arrangements are split up by rank; see duplicate_finder.h.
+VerifyStrategyResult verify_strategy(int n, int d, const std::vector<std::string>& tests,
+                                     DuplicateEngine engine = DuplicateEngine::Automatic, int num_threads = 1);
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+
+// A set of up to 64*N animals, stored as N little-endian 64-bit words.
+// It supports just the arithmetic that the wolves solver does on its masks,
+// so that the solver can be templated on the mask type and still use
+// "unsigned long long" when n <= 64. A WideMask<2> fits one SSE register
+// and a WideMask<4> one AVX register. We align to 16 bytes and no more,
+// because in C++14 std::vector won't honor any stricter alignment.
+//
+template<int N>
+struct alignas(16) WideMask {
+    uint64_t w[N];
+
+    WideMask() = default;
+    WideMask(uint64_t x) : w{x} {}
+
+    friend WideMask operator&(const WideMask& a, const WideMask& b) {
+        WideMask r;
+        for (int i = 0; i < N; ++i) r.w[i] = a.w[i] & b.w[i];
+        return r;
+    }
+    friend WideMask operator|(const WideMask& a, const WideMask& b) {
+        WideMask r;
+        for (int i = 0; i < N; ++i) r.w[i] = a.w[i] | b.w[i];
+        return r;
+    }
+    friend WideMask operator^(const WideMask& a, const WideMask& b) {
+        WideMask r;
+        for (int i = 0; i < N; ++i) r.w[i] = a.w[i] ^ b.w[i];
+        return r;
+    }
+    friend WideMask operator~(const WideMask& a) {
+        WideMask r;
+        for (int i = 0; i < N; ++i) r.w[i] = ~a.w[i];
+        return r;
+    }
+    WideMask& operator&=(const WideMask& b) { return *this = (*this & b); }
+    WideMask& operator|=(const WideMask& b) { return *this = (*this | b); }
+
+    friend WideMask operator<<(const WideMask& a, int s) {
+        WideMask r(0);
+        const int words = s / 64;
+        const int bits = s % 64;
+        for (int i = N - 1; i >= words; --i) {
+            r.w[i] = a.w[i - words] << bits;
+            if (bits != 0 && i - words - 1 >= 0) {
+                r.w[i] |= a.w[i - words - 1] >> (64 - bits);
+            }
+        }
+        return r;
+    }
+    friend WideMask operator>>(const WideMask& a, int s) {
+        WideMask r(0);
+        const int words = s / 64;
+        const int bits = s % 64;
+        for (int i = 0; i + words < N; ++i) {
+            r.w[i] = a.w[i + words] >> bits;
+            if (bits != 0 && i + words + 1 < N) {
+                r.w[i] |= a.w[i + words + 1] << (64 - bits);
+            }
+        }
+        return r;
+    }
+    WideMask& operator<<=(int s) { return *this = (*this << s); }
+
+    friend WideMask operator+(const WideMask& a, const WideMask& b) {
+        WideMask r;
+        uint64_t carry = 0;
+        for (int i = 0; i < N; ++i) {
+            uint64_t sum = a.w[i] + carry;
+            carry = (sum < carry);
+            r.w[i] = sum + b.w[i];
+            carry += (r.w[i] < sum);
+        }
+        return r;
+    }
+    friend WideMask operator-(const WideMask& a, const WideMask& b) {
+        WideMask r;
+        uint64_t borrow = 0;
+        for (int i = 0; i < N; ++i) {
+            uint64_t diff = a.w[i] - borrow;
+            borrow = (a.w[i] < borrow);
+            r.w[i] = diff - b.w[i];
+            borrow += (diff < b.w[i]);
+        }
+        return r;
+    }
+    WideMask& operator++() { return *this = (*this + WideMask(1)); }
+
+    friend bool operator==(const WideMask& a, const WideMask& b) {
+        uint64_t diff = 0;
+        for (int i = 0; i < N; ++i) diff |= (a.w[i] ^ b.w[i]);
+        return diff == 0;
+    }
+    friend bool operator!=(const WideMask& a, const WideMask& b) { return !(a == b); }
+    friend bool operator<(const WideMask& a, const WideMask& b) {
+        for (int i = N - 1; i >= 0; --i) {
+            if (a.w[i] != b.w[i]) return a.w[i] < b.w[i];
+        }
+        return false;
+    }
+
+    friend int popcount(const WideMask& a) {
+        int r = 0;
+        for (int i = 0; i < N; ++i) r += __builtin_popcountll(a.w[i]);
+        return r;
+    }
+};
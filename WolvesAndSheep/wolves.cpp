@@ -1,18 +1,58 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <limits.h>
+#include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 #include <string>
+#include <thread>
 #include <vector>
+#include "checkpoint.h"
+#include "lower_bounds.h"
+#include "transposition_table.h"
+#include "wide_mask.h"
 #include "wolves.h"
 
+// WOLVES_SIMD selects the kernel that evaluates a test against many candidates at once:
+// 512 for AVX-512, 256 for AVX2, 0 for plain scalar code. By default we use
+// the widest one the compiler is targeting (i.e., whatever -march=native gives us).
+#ifndef WOLVES_SIMD
+ #if defined(__AVX512F__)
+  #define WOLVES_SIMD 512
+ #elif defined(__AVX2__)
+  #define WOLVES_SIMD 256
+ #else
+  #define WOLVES_SIMD 0
+ #endif
+#endif
+
+#if WOLVES_SIMD
+#include <immintrin.h>
+#endif
+
 using Int = unsigned long long;
 
+// The search is templated on the type of a test mask (and of a candidate
+// arrangement of wolves): Int when n <= 64, and a WideMask when n is bigger.
+
+// Saturates at ULLONG_MAX, which is more candidates than we could ever enumerate anyway.
 static Int choose(int n, int k) {
     if (k > n) return Int(0);
-    if (k == 0 || k == n) return Int(1);
-    if (k == 1 || k == n-1) return Int(n);
-    return choose(n-1, k) + choose(n-1, k-1);
+    k = std::min(k, n - k);
+    Int result = 1;
+    for (int i = 0; i < k; ++i) {
+        // result * (n-i) / (i+1) is exact, because result * (n-i) is (i+1) * choose(n, i+1).
+        unsigned __int128 r = (unsigned __int128)result * (n - i) / (i + 1);
+        if (r > ULLONG_MAX) return ULLONG_MAX;
+        result = Int(r);
+    }
+    return result;
 }
 
 static inline
@@ -22,8 +62,8 @@ int ceil_div(int x, int y) {
 
 static inline
 int ceil_lg(Int value) {
-    Int r = 0;
-    while (value > (Int(1) << r)) {
+    int r = 0;
+    while (r < 64 && value > (Int(1) << r)) {
         ++r;
     }
     return r;
@@ -45,10 +85,11 @@ int popcount(Int value) {
 }
 
 static inline
-bool is_power_of_2_minus_1(Int x) {
-    Int y = x;
-    ++y;
-    return (y & x) == 0;
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9uLL;
+    x ^= x >> 27; x *= 0x94d049bb133111ebuLL;
+    x ^= x >> 31;
+    return x;
 }
 
 static std::string format(const char *fmt, ...) {
@@ -72,88 +113,559 @@ static std::string format(const char *fmt, ...) {
     return result;
 }
 
-struct Candidate {
-    Int is_wolf;  // n bits, has exactly k nonzero bits
-    Int test_results;  // t bits, each representing the result of a test
-    explicit Candidate(Int v) : is_wolf(v) {}
+// The candidate arrangements of wolves are stored "structure of arrays" style,
+// so that we can evaluate a test against several candidates per instruction.
+// The candidates are kept grouped into equivalence classes: candidates that
+// our tests so far can't tell apart are stored contiguously, in a ClassRange.
+template<class Mask>
+struct CandidateStore {
+    std::vector<Mask> is_wolf;  // n bits each, with exactly k nonzero bits
+
+    explicit CandidateStore(std::vector<Mask> wolves) : is_wolf(std::move(wolves)) {}
+
+    size_t size() const { return is_wolf.size(); }
 };
 
-static std::vector<Candidate> make_candidates(int n, int k) {
+struct ClassRange {
+    size_t first;
+    size_t last;
+    size_t size() const { return last - first; }
+};
+
+template<class Mask>
+static std::vector<Mask> make_candidates(int n, int k) {
     assert(n >= 0);
     assert(k >= 0);
     if (k == 0) {
-        return std::vector<Candidate>{ Candidate(0) };
+        return std::vector<Mask>{ Mask(0) };
     } else if (k > n) {
-        return std::vector<Candidate>{};
+        return std::vector<Mask>{};
     } else {
-        std::vector<Candidate> a = make_candidates(n-1, k);
-        std::vector<Candidate> b = make_candidates(n-1, k-1);
-        for (auto&& cand : a) cand.is_wolf <<= 1;
-        for (auto&& cand : b) cand.is_wolf = (cand.is_wolf << 1) | 1;
-        a.reserve(a.size() + b.size());
-        for (auto&& cand : b) { a.push_back(std::move(cand)); }
+        std::vector<Mask> a = make_candidates<Mask>(n-1, k);
+        std::vector<Mask> b = make_candidates<Mask>(n-1, k-1);
+        for (Mask& is_wolf : a) is_wolf <<= 1;
+        for (Mask& is_wolf : b) is_wolf = (is_wolf << 1) | Mask(1);
+        a.insert(a.end(), b.begin(), b.end());
         return a;
     }
 }
 
-static void report_solution(const std::vector<Int>& solution, int n, int t, const std::vector<Candidate>& cands)
+// How many of the candidates in [first, last) would make test "m" come back wolfy?
+static inline
+size_t count_wolfy(const Int *is_wolf, size_t first, size_t last, Int m)
 {
-    std::string message;
-    message += format("Awesome, I think I found a solution using %d blood tests!\n", t);
-    message += format("  My %d tests use blood from the following sheep:\n", t);
-    for (int i = 0; i < t; ++i) {
-        message += format("  %d.%s", i+1, (i >= 9) ? "" : " ");
-        auto m = solution[i];
-        for (int sheep = 0; sheep < n; ++sheep) {
-            bool this_sheep_is_used = ((m & (Int(1) << sheep)) != 0);
-            message += format(" %c", this_sheep_is_used ? 'T' : '.');
-        }
-        message += format("\n");
+    size_t count = 0;
+#if WOLVES_SIMD == 512
+    const __m512i mv = _mm512_set1_epi64(m);
+    for ( ; first + 8 <= last; first += 8) {
+        __m512i w = _mm512_loadu_si512(is_wolf + first);
+        count += __builtin_popcount(_mm512_test_epi64_mask(w, mv));
     }
-#if 0
-    message += format("The test results for each arrangement of wolves are:\n");
-    for (auto&& cand : cands) {
-            message += format("Candidate wolves:");
-            for (int i=0; i < n; ++i) {
-                bool sheep_is_wolf = (cand.is_wolf & (Int(1) << i)) != 0;
-                message += format(" %d", sheep_is_wolf ? 1 : 0);
-            }
-            message += format("   Test results: ");
-            for (int i=0; i < t; ++i) {
-                bool test_was_positive = (cand.test_results & (Int(1) << i)) != 0;
-                message += format(" %c", test_was_positive ? '+' : '-');
-            }
-            message += format("\n");
+#elif WOLVES_SIMD == 256
+    const __m256i mv = _mm256_set1_epi64x(m);
+    const __m256i zero = _mm256_setzero_si256();
+    for ( ; first + 4 <= last; first += 4) {
+        __m256i w = _mm256_loadu_si256((const __m256i*)(is_wolf + first));
+        __m256i not_wolfy = _mm256_cmpeq_epi64(_mm256_and_si256(w, mv), zero);
+        count += 4 - __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(not_wolfy)));
     }
 #endif
-    throw NktResult(true, message);
+    for ( ; first < last; ++first) {
+        count += ((m & is_wolf[first]) != 0);
+    }
+    return count;
 }
 
+// The same, for wide masks. Each candidate is one contiguous WideMask,
+// so the compiler can do the AND-and-test in a single vector register.
+template<int N>
 static inline
-Int increment(Int m, int i) {
-    if (i == 0) {
-        m <<= 1;
+size_t count_wolfy(const WideMask<N> *is_wolf, size_t first, size_t last, const WideMask<N>& m)
+{
+    size_t count = 0;
+    for ( ; first < last; ++first) {
+        count += ((m & is_wolf[first]) != 0);
     }
-    ++m;
-    return m;
+    return count;
+}
+
+// Move the candidates in [first, last) for which test "m" comes back clean
+// ahead of the ones for which it comes back wolfy; return how many are clean.
+static inline
+size_t partition_by_test(Int *is_wolf, size_t first, size_t last, Int m)
+{
+    size_t clean = first;
+    for (size_t j = first; j < last; ++j) {
+        Int w = is_wolf[j];
+        is_wolf[j] = is_wolf[clean];
+        is_wolf[clean] = w;
+        clean += ((m & w) == 0);
+    }
+    return clean - first;
+}
+
+template<int N>
+static inline
+size_t partition_by_test(WideMask<N> *is_wolf, size_t first, size_t last, const WideMask<N>& m)
+{
+    size_t clean = first;
+    for (size_t j = first; j < last; ++j) {
+        WideMask<N> w = is_wolf[j];
+        is_wolf[j] = is_wolf[clean];
+        is_wolf[clean] = w;
+        clean += ((m & w) == 0);
+    }
+    return clean - first;
+}
+
+// What attempt_testing tells its caller: keep looking, or stop because
+// state.solution holds a solution, or stop because we were told to.
+enum class SearchOutcome { KeepGoing, Found, Terminated };
+
+static inline
+int bit_length(Int value) {
+    return (value == 0) ? 0 : 64 - __builtin_clzll(value);
+}
+
+template<int N>
+static inline
+int bit_length(const WideMask<N>& value) {
+    for (int i = N - 1; i >= 0; --i) {
+        if (value.w[i] != 0) return 64 * i + bit_length(Int(value.w[i]));
+    }
+    return 0;
+}
+
+// The size of the biggest group of twins (see lower_bounds.h), given the set
+// of sheep s for which s-1 and s are in different groups.
+static inline
+int largest_twin_group(Int boundaries, int n)
+{
+    int largest = 0;
+    int prev = 0;
+    while (boundaries != 0) {
+        int s = __builtin_ctzll(boundaries);
+        largest = std::max(largest, s - prev);
+        prev = s;
+        boundaries &= boundaries - 1;
+    }
+    return std::max(largest, n - prev);
+}
+
+template<int N>
+static inline
+int largest_twin_group(const WideMask<N>& boundaries, int n)
+{
+    int largest = 0;
+    int prev = 0;
+    for (int i = 0; i < N; ++i) {
+        for (Int word = boundaries.w[i]; word != 0; word &= word - 1) {
+            int s = 64 * i + __builtin_ctzll(word);
+            largest = std::max(largest, s - prev);
+            prev = s;
+        }
+    }
+    return std::max(largest, n - prev);
+}
+
+// Enumerates, in increasing order, just the masks we're willing to try as the next test:
+// those that introduce new animals in order (so that, if animals [0, introduced)
+// have been tested so far, the new test's animals outside that range are
+// exactly [introduced, v) for some v < n) and that involve at most max_population
+// animals. Such a mask is (2^v - 2^introduced) plus some subset "low" of the
+// old animals; we step through v, and for each v through every "low" whose
+// weight fits, skipping a whole run of too-heavy values of "low" at once.
+//
+template<class Mask>
+class AdmissibleMasks {
+public:
+    explicit AdmissibleMasks(int n, int introduced, int max_population, const Mask& start) :
+        n_(n), introduced_(introduced), max_population_(max_population),
+        low_end_(Mask(1) << introduced)
+    {
+        // Find the first candidate v and low at or after "start".
+        Mask high = start >> introduced;
+        int len = bit_length(high);
+        v_ = introduced + len;
+        if (high == (Mask(1) << len) - Mask(1)) {
+            low_ = start & (low_end_ - Mask(1));
+        } else {
+            low_ = Mask(0);  // the next contiguous block is bigger than "high"
+        }
+        start_block();
+        settle();
+    }
+
+    const Mask& mask() const { return m_; }
+    bool done() const { return budget_ < 0; }
+
+    void advance() {
+        ++low_;
+        settle();
+    }
+
+private:
+    void start_block() {
+        if (v_ >= n_) {
+            budget_ = -1;
+            return;
+        }
+        budget_ = (max_population_ == INT_MAX) ? INT_MAX : max_population_ - (v_ - introduced_);
+        high_ = (Mask(1) << v_) - low_end_;
+    }
+
+    void settle() {
+        while (budget_ >= 0) {
+            while (low_ < low_end_ && popcount(low_) > budget_) {
+                // Every value from low_ up to (but not including) low_ + lowest_bit(low_)
+                // has all of low_'s bits set, so it's too heavy too.
+                low_ = low_ + (low_ & (~low_ + Mask(1)));
+            }
+            if (low_ < low_end_) {
+                m_ = high_ | low_;
+                return;
+            }
+            ++v_;
+            low_ = Mask(0);
+            start_block();
+        }
+    }
+
+    int n_;
+    int introduced_;
+    int max_population_;
+    Mask low_end_;
+    int v_;
+    int budget_;
+    Mask high_;
+    Mask low_;
+    Mask m_;
+};
+
+// Checkpoint files store each test as sizeof(Mask)/8 little-endian words.
+template<class Mask>
+static void append_words(std::vector<uint64_t>& words, const Mask *masks, size_t count)
+{
+    static_assert(sizeof(Mask) % sizeof(uint64_t) == 0, "");
+    size_t old_size = words.size();
+    words.resize(old_size + count * (sizeof(Mask) / sizeof(uint64_t)));
+    memcpy(words.data() + old_size, masks, count * sizeof(Mask));
+}
+
+template<class Mask>
+static std::vector<Mask> masks_from_words(const std::vector<uint64_t>& words)
+{
+    std::vector<Mask> masks(words.size() / (sizeof(Mask) / sizeof(uint64_t)));
+    memcpy(masks.data(), words.data(), masks.size() * sizeof(Mask));
+    return masks;
 }
 
 namespace {
-template<class A, class B>
+// Each worker owns a deque of tasks. It takes its own tasks from the back;
+// when it runs out, it steals from the front of somebody else's deque.
+template<class Task>
+class WorkStealingQueues {
+    struct Queue {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+    std::unique_ptr<Queue[]> queues_;
+    int num_workers_;
+public:
+    explicit WorkStealingQueues(int num_workers) :
+        queues_(new Queue[num_workers]), num_workers_(num_workers) {}
+
+    void push(int worker, Task task) {
+        std::lock_guard<std::mutex> lk(queues_[worker].mtx);
+        queues_[worker].tasks.push_back(std::move(task));
+    }
+
+    bool pop(int worker, Task& task) {
+        for (int i = 0; i < num_workers_; ++i) {
+            Queue& q = queues_[(worker + i) % num_workers_];
+            std::lock_guard<std::mutex> lk(q.mtx);
+            if (!q.tasks.empty()) {
+                if (i == 0) {
+                    task = std::move(q.tasks.back());
+                    q.tasks.pop_back();
+                } else {
+                    task = std::move(q.tasks.front());
+                    q.tasks.pop_front();
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template<class F>
+    void for_each(const F& f) {
+        for (int i = 0; i < num_workers_; ++i) {
+            std::lock_guard<std::mutex> lk(queues_[i].mtx);
+            for (const Task& task : queues_[i].tasks) {
+                f(task);
+            }
+        }
+    }
+};
+
+// Everything a search has yet to do: the items waiting in the work queues,
+// plus whatever each worker is in the middle of. If we're checkpointing,
+// each worker reports every so often how far it's gotten through its
+// current item, and the whole frontier periodically saves itself to a file.
+class SearchFrontier {
+public:
+    explicit SearchFrontier(int num_workers) :
+        queues_(num_workers), current_(num_workers), busy_(num_workers) {}
+
+    void enable_checkpoints(std::string directory, int n, int k, int t, const std::atomic<int> *target_t,
+                            int words_per_test, int interval_seconds) {
+        directory_ = std::move(directory);
+        filename_ = checkpoint_filename(directory_, n, k, t);
+        n_ = n; k_ = k; t_ = t;
+        target_t_ = target_t;
+        words_per_test_ = words_per_test;
+        interval_ = std::chrono::seconds(interval_seconds);
+        next_save_ = std::chrono::steady_clock::now() + interval_;
+    }
+
+    bool checkpointing() const { return !filename_.empty(); }
+
+    void push(int worker, FrontierItem item) {
+        queues_.push(worker, std::move(item));
+    }
+
+    bool take(int worker, FrontierItem& item) {
+        if (!checkpointing()) {
+            return queues_.pop(worker, item);
+        }
+        // Popping an item and making it our current one must look atomic to save().
+        std::lock_guard<std::mutex> lk(mtx_);
+        busy_[worker] = queues_.pop(worker, item);
+        if (busy_[worker]) {
+            current_[worker] = item;
+        }
+        return busy_[worker];
+    }
+
+    template<class Mask>
+    void report_position(int worker, const std::vector<Mask>& solution, int depth) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        current_[worker].resume.clear();
+        append_words(current_[worker].resume, solution.data(), depth);
+        if (std::chrono::steady_clock::now() >= next_save_) {
+            save_locked();
+            next_save_ = std::chrono::steady_clock::now() + interval_;
+        }
+    }
+
+    void save() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        save_locked();
+    }
+
+    void remove_file() {
+        remove(filename_.c_str());
+    }
+
+private:
+    void save_locked() {
+        std::vector<FrontierItem> items;
+        for (size_t w = 0; w < current_.size(); ++w) {
+            if (busy_[w]) {
+                items.push_back(current_[w]);
+            }
+        }
+        queues_.for_each([&](const FrontierItem& item) {
+            items.push_back(item);
+        });
+        // If our target has come down since we started (see solve_wolves in wolves.h),
+        // then what's left is work for the lower target, and goes in that target's file.
+        const int t = (target_t_ == nullptr) ? t_ : std::min(t_, target_t_->load());
+        std::string filename = checkpoint_filename(directory_, n_, k_, t);
+        if (!write_checkpoint(filename, n_, k_, t, words_per_test_, items)) {
+            fprintf(stderr, "Failed to write checkpoint file %s\n", filename.c_str());
+        } else if (filename != filename_) {
+            remove(filename_.c_str());
+            filename_ = std::move(filename);
+        }
+    }
+
+    WorkStealingQueues<FrontierItem> queues_;
+    std::mutex mtx_;
+    std::vector<FrontierItem> current_;
+    std::vector<bool> busy_;
+    std::string directory_;
+    std::string filename_;  // the file we last saved (or resumed from)
+    int n_ = 0, k_ = 0, t_ = 0;
+    const std::atomic<int> *target_t_ = nullptr;
+    int words_per_test_ = 1;
+    std::chrono::steady_clock::duration interval_{};
+    std::chrono::steady_clock::time_point next_save_;
+};
+
+// Statistics for one search. Each worker counts into its own TestingState,
+// and every so often publishes a copy of its counters here; so the search
+// itself never touches shared memory just to count.
+class SearchMonitor {
+public:
+    explicit SearchMonitor(int n, int k, int t, int num_workers, int interval_seconds,
+                           const std::function<void(const SearchStats&)>& report) :
+        report_(report), workers_(num_workers), interval_(std::chrono::seconds(interval_seconds))
+    {
+        n_ = n; k_ = k; t_ = t;
+        start_ = std::chrono::steady_clock::now();
+        next_report_ = start_ + interval_;
+    }
+
+    void set_num_tasks(size_t count) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        num_tasks_ = count;
+    }
+
+    void finish_task() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        tasks_done_ += 1;
+    }
+
+    void publish(int worker, const uint64_t *nodes_at_depth, const uint64_t *pruned) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        std::copy(nodes_at_depth, nodes_at_depth + t_, workers_[worker].nodes_at_depth);
+        std::copy(pruned, pruned + kNumPruneReasons, workers_[worker].pruned);
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_report_) {
+            report_locked(false);
+            next_report_ = now + interval_;
+        }
+    }
+
+    void finish() {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (reported_) {
+            report_locked(true);
+        }
+    }
+
+private:
+    struct Counters {
+        uint64_t nodes_at_depth[kMaxSheep] = {};
+        uint64_t pruned[kNumPruneReasons] = {};
+    };
+
+    void report_locked(bool finished) {
+        SearchStats stats;
+        stats.n = n_;
+        stats.k = k_;
+        stats.t = t_;
+        stats.finished = finished;
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+        for (const Counters& c : workers_) {
+            for (int i = 0; i < t_; ++i) {
+                stats.nodes_at_depth[i] += c.nodes_at_depth[i];
+                stats.nodes += c.nodes_at_depth[i];
+            }
+            for (int r = 0; r < kNumPruneReasons; ++r) {
+                stats.pruned[r] += c.pruned[r];
+            }
+        }
+        stats.fraction_done = finished ? 1.0 : (num_tasks_ != 0) ? double(tasks_done_) / num_tasks_ : 0.0;
+        report_(stats);
+        reported_ = true;
+    }
+
+    const std::function<void(const SearchStats&)>& report_;
+    std::mutex mtx_;
+    std::vector<Counters> workers_;
+    int n_ = 0, k_ = 0, t_ = 0;
+    size_t num_tasks_ = 0;
+    size_t tasks_done_ = 0;
+    bool reported_ = false;
+    std::chrono::steady_clock::duration interval_;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point next_report_;
+};
+} // anonymous namespace
+
+struct CheckpointSettings {
+    std::string directory;  // empty means "don't checkpoint"
+    int interval_seconds = 600;
+    bool resume = false;
+};
+
+struct StatsSettings {
+    int interval_seconds = 0;  // zero means "don't report"
+    std::function<void(const SearchStats&)> report;
+};
+
+namespace {
+template<class Mask, class A, class B>
 struct TestingState {
-    std::vector<Candidate> cands;
-    std::vector<Int> solution;
-    std::vector<Int> partial_result_counts;
+    CandidateStore<Mask> cands;
+    std::vector<Mask> solution;
+    int solution_length = 0;  // once we've found one
+
+    // While we're choosing test i, the classes of candidates not yet distinguished
+    // by solution[0..i) are classes[class_marks[i]..]; singletons aren't recorded.
+    // Refining the partition with test i pushes the new classes onto the end
+    // (clean half first, then wolfy half); backtracking simply truncates
+    // "classes" back to where it was. That's our whole undo log.
+    std::vector<ClassRange> classes;
+    std::vector<size_t> class_marks;
+
+    // twin_boundaries[i] is the set of sheep s such that solution[0..i) tells
+    // sheep s-1 and s apart; see lower_bounds.h.
+    std::vector<Mask> twin_boundaries;
+    const TwinGroupBound *twin_bound = nullptr;
+
+    // Counters for SearchStats.
+    uint64_t nodes_at_depth[kMaxSheep] = {};
+    uint64_t pruned[kNumPruneReasons] = {};
+
     A early_terminate;
     B test_is_acceptable;
 
-    explicit TestingState(A a, B b) :
-        early_terminate(std::move(a)), test_is_acceptable(std::move(b)) {}
+    // If non-null, look only for solutions with at most this many tests
+    // (which is at most t, and can go down while we search).
+    const std::atomic<int> *target_t = nullptr;
+
+    // If non-null, remember positions from which we couldn't find a solution.
+    TranspositionTable *transpositions = nullptr;
+    uint64_t transposition_seed = 0;
+
+    // If non-empty, the first tests must be exactly these: we're searching
+    // only the subtree under this prefix.
+    std::vector<Mask> forced_prefix;
+
+    // If non-null, don't search below depth split_depth; instead, collect
+    // each prefix that reaches that depth, to be searched later.
+    std::vector<std::vector<Mask>> *split_prefixes = nullptr;
+    int split_depth = 0;
+
+    // If non-empty, we're resuming from a checkpoint: at each depth
+    // i < resume.size(), skip the tests that come before resume[i].
+    std::vector<Mask> resume;
+
+    // If non-null, tell the frontier every so often where we are,
+    // and the monitor what we've counted.
+    SearchFrontier *frontier = nullptr;
+    SearchMonitor *monitor = nullptr;
+    int worker_index = 0;
+    uint64_t nodes_visited = 0;
+
+    explicit TestingState(CandidateStore<Mask> c, A a, B b) :
+        cands(std::move(c)), early_terminate(std::move(a)), test_is_acceptable(std::move(b)) {}
+
+    void reset(int t) {
+        solution.assign(t, Mask(0));
+        classes.assign(1, ClassRange{0, cands.size()});
+        class_marks.assign(t + 1, 0);
+        twin_boundaries.assign(t + 1, Mask(0));
+    }
 
     bool animals_in_same_group(int s1, int s2, int t) const {
         assert(s2 == s1 + 1);
-        Int mask = (Int(3) << s1);  // s1 and s2
-        Int okay_mask = (Int(1) << s1);  // s1 is present, s2 is not
+        Mask mask = (Mask(3) << s1);  // s1 and s2
+        Mask okay_mask = (Mask(1) << s1);  // s1 is present, s2 is not
         for (int i=0; i < t; ++i) {
             if ((solution[i] & mask) == okay_mask) {
                 return false;
@@ -161,17 +673,74 @@ struct TestingState {
         }
         return true;
     }
+
+    // A hash of the first i tests, exactly as they are, labels and order included.
+    // Everything attempt_testing does below this position -- which tests may come
+    // next, the classes, the twin groups, the order in which animals are introduced --
+    // is a function of those tests, of n and k (which are in the seed), and of how
+    // many tests remain (which the table records). So a position that was hopeless
+    // once is hopeless every time we reach it. Within one search each prefix is
+    // reached only once; the hits come from searching the same (n,k) again with
+    // as many tests or fewer, e.g. as st and mt step t down.
+    uint64_t position_hash(int i) const {
+        static_assert(sizeof(Mask) % sizeof(uint64_t) == 0, "");
+        const uint64_t *words = reinterpret_cast<const uint64_t*>(solution.data());
+        uint64_t h = mix64(transposition_seed ^ uint64_t(i));
+        for (size_t w = 0; w < i * (sizeof(Mask) / sizeof(uint64_t)); ++w) {
+            h = mix64(h ^ words[w]);
+        }
+        return h;
+    }
 };
 } // anonymous namespace
 
-template<class A, class B>
-static void attempt_testing(TestingState<A, B>& state, int n, int i, int t) {
-    assert(i < t);
+static std::unique_ptr<TranspositionTable> g_transposition_table;
+static CheckpointSettings g_checkpoint_settings;
+static StatsSettings g_stats_settings;
+
+static const CheckpointSettings *checkpoint_settings()
+{
+    return g_checkpoint_settings.directory.empty() ? nullptr : &g_checkpoint_settings;
+}
+
+static const StatsSettings *stats_settings()
+{
+    return (g_stats_settings.interval_seconds <= 0) ? nullptr : &g_stats_settings;
+}
+
+// Positions with fewer remaining tests than this are cheaper to search than to hash.
+static constexpr int kTranspositionMinRemaining = 3;
+
+// Classes at least this big get a SIMD counting pass before we partition them.
+static constexpr size_t kLargeClassSize = 64;
+
+// How often (in nodes) a worker tells the frontier where it is, and the monitor what it's counted.
+static constexpr uint64_t kNodesBetweenReports = uint64_t(1) << 12;
+
+template<class Mask, class A, class B>
+static SearchOutcome attempt_testing(TestingState<Mask, A, B>& state, int n, int i, int t) {
     if (state.early_terminate()) {
-        throw EarlyTerminateException();
+        return SearchOutcome::Terminated;
+    }
+    if (state.target_t != nullptr) {
+        // Somebody may have lowered our target since our caller looked.
+        t = std::min(t, state.target_t->load(std::memory_order_relaxed));
+        if (i >= t) {
+            return SearchOutcome::KeepGoing;
+        }
+    }
+    assert(i < t);
+    state.nodes_at_depth[i] += 1;
+    if ((state.frontier != nullptr || state.monitor != nullptr) && (++state.nodes_visited % kNodesBetweenReports) == 0) {
+        if (state.frontier != nullptr) {
+            state.frontier->report_position(state.worker_index, state.solution, i);
+        }
+        if (state.monitor != nullptr) {
+            state.monitor->publish(state.worker_index, state.nodes_at_depth, state.pruned);
+        }
     }
 
-    Int mask_so_far = Int(0);
+    Mask mask_so_far = Mask(0);
     for (int j=0; j < i; ++j) mask_so_far |= state.solution[j];
 
     // Without loss of generality, we can assume that the tests are performed
@@ -183,40 +752,83 @@ static void attempt_testing(TestingState<A, B>& state, int n, int i, int t) {
     int animals_yet_to_test = (n - 1) - popcount(mask_so_far);
     int remaining_tests = (t - i);
     if (i != 0 && animals_yet_to_test > max_population * remaining_tests) {
-        return;
+        state.pruned[int(PruneReason::Pigeonhole)] += 1;
+        return SearchOutcome::KeepGoing;
+    }
+
+    if (state.split_prefixes != nullptr && i == state.split_depth) {
+        state.split_prefixes->emplace_back(state.solution.begin(), state.solution.begin() + i);
+        return SearchOutcome::KeepGoing;
     }
+    const bool prefix_is_forced = (i < int(state.forced_prefix.size()));
+    const bool resuming_here = (i < int(state.resume.size()));
 
-    Int starting_m = (i == 0) ? 1 : state.solution[i-1] + 1;
+    // Have we (or another thread, or an earlier search) already failed to complete
+    // these i tests, with at least as many tests remaining as we have now?
+    // (If we're only collecting prefixes, or only searching under a fixed
+    // prefix, or resuming partway through, then we won't have searched this
+    // whole position when we're done.)
+    const bool use_transpositions =
+        (state.transpositions != nullptr && i != 0 && remaining_tests >= kTranspositionMinRemaining) &&
+        (state.split_prefixes == nullptr) && !prefix_is_forced && !resuming_here;
+    uint64_t position_hash = 0;
+    if (use_transpositions) {
+        position_hash = state.position_hash(i);
+        if (state.transpositions->is_hopeless(position_hash, remaining_tests)) {
+            state.pruned[int(PruneReason::Transposition)] += 1;
+            return SearchOutcome::KeepGoing;
+        }
+    }
+
+    Mask starting_m = (i == 0) ? Mask(1) : state.solution[i-1] + Mask(1);
+    Mask ending_m = (Mask(1) << (n - 1)) - Mask(1);
+    if (prefix_is_forced) {
+        starting_m = state.forced_prefix[i];
+        ending_m = starting_m + 1;
+    } else if (resuming_here) {
+        starting_m = state.resume[i];
+    }
 
     // Information theory tells us that, after this test is performed, if our tests
     // thus far have given identical results for more than 2^(remaining tests)
     // distinct candidate sets of wolves, then it's hopeless; we'll never distinguish
     // all of those sets in just (remaining tests) tests.
-    const Int permissible_indistinguishable_cases = Int(1) << (remaining_tests - 1);
+    const Int permissible_indistinguishable_cases =
+        (remaining_tests > 64) ? ULLONG_MAX : Int(1) << (remaining_tests - 1);
 
-    for (Int m = starting_m; m < (Int(1) << (n - 1)) - 1; m = increment(m, i)) {
+    // After this test, no group of twins may be bigger than this.
+    const int largest_feasible_group = state.twin_bound->largest_feasible_group(remaining_tests - 1);
 
-        if (!state.test_is_acceptable(m)) {
-            continue;
-        }
+    const size_t classes_begin = state.class_marks[i];
+    const size_t classes_end = state.classes.size();
 
-        if (!is_power_of_2_minus_1(mask_so_far | m)) {
-            // Testing the 6th animal when we haven't touched the 5th animal yet is pointless.
-            // Without loss of generality we can assume the animals are introduced in order.
-            continue;
+    const int introduced = popcount(mask_so_far);
+    for (AdmissibleMasks<Mask> gen(n, introduced, max_population, starting_m); !gen.done() && gen.mask() < ending_m; gen.advance()) {
+        const Mask m = gen.mask();
+
+        if (m != starting_m && state.resume.size() > size_t(i + 1)) {
+            // We've finished the subtree we were resuming in; from here on,
+            // the deeper tests start from the beginning again.
+            state.resume.resize(i + 1);
         }
-        if (popcount(m) > max_population) {
+
+        if (!state.test_is_acceptable(m)) {
             continue;
         }
 
+        // Testing the 6th animal when we haven't touched the 5th animal yet is pointless.
+        // Without loss of generality we can assume the animals are introduced in order;
+        // "gen" gives us only such tests, and only those no heavier than the last one.
+
         // Without loss of generality, we can keep the columns decreasing to the right.
         // That is, if Sheeps 1 and 2 have been in the same test groups all the time
         // up to this point, we should not introduce Sheep 2 into a new group unless Sheep 1
         // is already there (but we might introduce Sheep 1 without Sheep 2).
-        for (int s2 = 1; s2 < n; ++s2) {
+        // (New animals all come in together, so only the old ones need checking.)
+        for (int s2 = 1; s2 < introduced; ++s2) {
             int s1 = s2 - 1;
-            bool sheep2_in_group = (m & (Int(1) << s2)) != 0;
-            bool sheep1_in_group = (m & (Int(1) << s1)) != 0;
+            bool sheep2_in_group = (m & (Mask(1) << s2)) != 0;
+            bool sheep1_in_group = (m & (Mask(1) << s1)) != 0;
             if (sheep2_in_group && !sheep1_in_group) {
                 if (state.animals_in_same_group(s1, s2, i)) {
                     goto abandon_this_line;
@@ -227,125 +839,472 @@ static void attempt_testing(TestingState<A, B>& state, int n, int i, int t) {
             abandon_this_line: continue;
         }
 
+        // This test splits each group of twins into the ones it involves
+        // and (just after them) the ones it doesn't.
+        const Mask twin_boundaries = state.twin_boundaries[i] | ((m << 1) & ~m);
+        if (largest_feasible_group < n && largest_twin_group(twin_boundaries, n) > largest_feasible_group) {
+            state.pruned[int(PruneReason::TwinGroup)] += 1;
+            continue;
+        }
+
         // Having performed this test, we want to make sure that it's still
         // information-theoretically possible to distinguish so-far-identical
         // cases in our remaining (t - i - 1) tests.
+        //
+        // Suppose the i'th test (out of t tests total) combines blood from these sheep.
+        // Each class of so-far-indistinguishable candidates splits into the candidates
+        // for which this test comes back wolfy and the ones for which it doesn't.
+        // For a large class we count first (using SIMD), so that we can give up
+        // before we've moved anything around; a small class we simply partition
+        // in place and then look at the sizes of the two halves.
+        state.classes.resize(classes_end);
+        for (size_t c = classes_begin; c < classes_end; ++c) {
+            ClassRange cls = state.classes[c];
+            size_t wolfy;
+            size_t not_wolfy;
+            if (cls.size() >= kLargeClassSize) {
+                wolfy = count_wolfy(state.cands.is_wolf.data(), cls.first, cls.last, m);
+                not_wolfy = cls.size() - wolfy;
+                if (wolfy > permissible_indistinguishable_cases || not_wolfy > permissible_indistinguishable_cases) {
+                    state.pruned[int(PruneReason::ClassSize)] += 1;
+                    goto abandon_this_line;
+                }
+                partition_by_test(state.cands.is_wolf.data(), cls.first, cls.last, m);
+            } else {
+                not_wolfy = partition_by_test(state.cands.is_wolf.data(), cls.first, cls.last, m);
+                wolfy = cls.size() - not_wolfy;
+                if (wolfy > permissible_indistinguishable_cases || not_wolfy > permissible_indistinguishable_cases) {
+                    state.pruned[int(PruneReason::ClassSize)] += 1;
+                    goto abandon_this_line;
+                }
+            }
+            if (not_wolfy >= 2) {
+                state.classes.push_back(ClassRange{cls.first, cls.first + not_wolfy});
+            }
+            if (wolfy >= 2) {
+                state.classes.push_back(ClassRange{cls.first + not_wolfy, cls.last});
+            }
+        }
 
-        bool these_tests_are_sufficient = true;
-        state.partial_result_counts.resize(Int(1) << (i + 1));
-        for (Int& count : state.partial_result_counts) {
-            count = 0;
+        state.solution[i] = m;
+        if (state.classes.size() == classes_end) {
+            // Every class is a singleton: these tests are sufficient.
+            state.solution_length = i+1;
+            return SearchOutcome::Found;
+        } else {
+            state.class_marks[i+1] = classes_end;
+            state.twin_boundaries[i+1] = twin_boundaries;
+            SearchOutcome outcome = attempt_testing(state, n, i+1, t);
+            if (outcome != SearchOutcome::KeepGoing) {
+                return outcome;
+            }
         }
+    }
+    state.classes.resize(classes_end);
 
-        // Suppose the i'th test (out of t tests total) combines blood from these sheep.
-        // What will the result of the test be, for each candidate arrangement of wolves?
-        for (auto& cand : state.cands) {
-            Int test_result = Int(0);
-            if (m & cand.is_wolf) {
-                test_result = Int(1) << i;
+    if (use_transpositions) {
+        state.transpositions->mark_hopeless(position_hash, remaining_tests);
+    }
+    return SearchOutcome::KeepGoing;
+}
+
+// Aim for this many tasks per thread, so that nobody is left idle for long
+// when the subtrees turn out to be wildly different sizes.
+static constexpr int kTasksPerThread = 16;
+
+// Split the top levels of the search into subtrees, and search them on
+// num_threads threads. The first thread to find a solution copies it into
+// state.solution, and the other threads are then cancelled through their
+// early_terminate hooks.
+//
+// When we're checkpointing, this is how we search even on a single thread,
+// because the work queues are what gets saved to the checkpoint file.
+// Likewise when we're reporting stats, because counting finished work items
+// is how we estimate how far along we are.
+template<class Mask, class A, class B>
+static SearchOutcome search_in_parallel(TestingState<Mask, A, B>& state, const std::vector<Mask>& cands, int n, int k, int t, int num_threads,
+                               const CheckpointSettings *checkpoints, SearchMonitor *monitor)
+{
+    SearchFrontier frontier(num_threads);
+    std::vector<FrontierItem> items;
+    const int words_per_test = sizeof(Mask) / sizeof(uint64_t);
+    if (checkpoints != nullptr) {
+        std::string filename = checkpoint_filename(checkpoints->directory, n, k, t);
+        if (checkpoints->resume && read_checkpoint(filename, n, k, t, words_per_test, items)) {
+            fprintf(stderr, "Resuming n=%d k=%d t=%d from %s (%zu items)\n", n, k, t, filename.c_str(), items.size());
+        } else {
+            items.clear();
+        }
+        frontier.enable_checkpoints(checkpoints->directory, n, k, t, state.target_t, words_per_test, checkpoints->interval_seconds);
+    }
+    if (items.empty()) {
+        // Collect prefixes of successively greater depth until we have enough.
+        // (A prefix that's already a solution ends the search right here.)
+        std::vector<std::vector<Mask>> prefixes;
+        for (int depth = 1; depth < t; ++depth) {
+            prefixes.clear();
+            state.split_prefixes = &prefixes;
+            state.split_depth = depth;
+            state.reset(t);
+            SearchOutcome outcome = attempt_testing(state, n, 0, t);
+            if (outcome != SearchOutcome::KeepGoing) {
+                state.split_prefixes = nullptr;
+                return outcome;
             }
-            cand.test_results &= (Int(1) << i) - 1;  // clear all bits [i..t)
-            cand.test_results |= test_result;        // set bit [i] appropriately
-
-            assert(cand.test_results < state.partial_result_counts.size());
-            Int& count = state.partial_result_counts[cand.test_results];
-            count += 1;
-            if (count > permissible_indistinguishable_cases) {
-                goto abandon_this_line;
-            } else if (count > 1) {
-                these_tests_are_sufficient = false;
+            if (prefixes.size() >= size_t(num_threads * kTasksPerThread)) {
+                break;
             }
         }
+        state.split_prefixes = nullptr;
+        for (auto&& prefix : prefixes) {
+            FrontierItem item;
+            append_words(item.prefix, prefix.data(), prefix.size());
+            items.push_back(std::move(item));
+        }
+    }
+
+    if (monitor != nullptr) {
+        monitor->set_num_tasks(items.size());
+    }
+
+    // Hand them out round-robin, so that each worker starts with a mix of
+    // early and late subtrees. Pushing them in reverse order means each worker
+    // searches its own share in the same order the single-threaded search would.
+    for (size_t i = items.size(); i-- != 0; ) {
+        frontier.push(i % num_threads, std::move(items[i]));
+    }
 
-        if (these_tests_are_sufficient) {
-            state.solution[i] = m;
-            report_solution(state.solution, n, i+1, state.cands);
+    std::atomic<bool> done(false);
+    std::mutex result_mtx;
+    bool found = false;
+    auto worker = [&](int w) {
+        auto early_terminate = [&]() {
+            return done.load(std::memory_order_relaxed) || state.early_terminate();
+        };
+        TestingState<Mask, decltype(early_terminate), B> local(CandidateStore<Mask>(cands), early_terminate, state.test_is_acceptable);
+        local.transpositions = state.transpositions;
+        local.transposition_seed = state.transposition_seed;
+        local.twin_bound = state.twin_bound;
+        local.target_t = state.target_t;
+        local.monitor = monitor;
+        local.worker_index = w;
+        if (frontier.checkpointing()) {
+            local.frontier = &frontier;
+        }
+        FrontierItem item;
+        while (frontier.take(w, item)) {
+            local.forced_prefix = masks_from_words<Mask>(item.prefix);
+            local.resume = masks_from_words<Mask>(item.resume);
+            local.reset(t);
+            SearchOutcome outcome = attempt_testing(local, n, 0, t);
+            if (outcome == SearchOutcome::Found) {
+                std::lock_guard<std::mutex> lk(result_mtx);
+                if (!found) {
+                    found = true;
+                    state.solution = local.solution;
+                    state.solution_length = local.solution_length;
+                }
+                done = true;
+            }
+            if (outcome != SearchOutcome::KeepGoing) {
+                // We found a solution, or somebody else did, or we were told to give up.
+                break;
+            }
+            if (monitor != nullptr) {
+                monitor->finish_task();
+            }
+        }
+        if (monitor != nullptr) {
+            monitor->publish(w, local.nodes_at_depth, local.pruned);
+        }
+        std::lock_guard<std::mutex> lk(result_mtx);
+        for (int r = 0; r < kNumPruneReasons; ++r) {
+            state.pruned[r] += local.pruned[r];
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int w = 1; w < num_threads; ++w) {
+        threads.emplace_back(worker, w);
+    }
+    worker(0);
+    for (auto&& th : threads) {
+        th.join();
+    }
+    const bool terminated = !found && state.early_terminate();
+    if (frontier.checkpointing()) {
+        if (terminated) {
+            // We were interrupted; save our place in case we're asked to resume.
+            frontier.save();
         } else {
-            state.solution[i] = m;
-            attempt_testing(state, n, i+1, t);
+            frontier.remove_file();
         }
     }
+    if (found) {
+        return SearchOutcome::Found;
+    } else if (terminated) {
+        return SearchOutcome::Terminated;
+    } else {
+        return SearchOutcome::KeepGoing;
+    }
+}
+
+// The part of the search that depends on the width of a mask.
+template<class Mask, class A, class B>
+static void search_for_solution(NktResult& result, int n, int k, int t, const A& early_terminate, const B& test_is_acceptable,
+                                TranspositionTable *transpositions, const CheckpointSettings *checkpoints,
+                                const StatsSettings *stats, int num_threads, const std::atomic<int> *target_t)
+{
+    std::vector<Mask> cands = make_candidates<Mask>(n, k);
+#if 0
+    for (const Mask& is_wolf : cands) {
+        printf("Candidate wolves:");
+        for (int i=0; i < n; ++i) {
+            bool sheep_is_wolf = (is_wolf & (Mask(1) << i)) != 0;
+            printf(" %d", sheep_is_wolf ? 1 : 0);
+        }
+        printf("\n");
+    }
+#endif
+    TestingState<Mask, A, B> state(CandidateStore<Mask>(cands), early_terminate, test_is_acceptable);
+    state.transpositions = transpositions;
+    state.transposition_seed = mix64((uint64_t(n) << 8) | uint64_t(k));
+    TwinGroupBound twin_bound(n, k);
+    state.twin_bound = &twin_bound;
+    state.target_t = target_t;
+    state.reset(t);
+    std::unique_ptr<SearchMonitor> monitor;
+    if (stats != nullptr) {
+        monitor.reset(new SearchMonitor(n, k, t, std::max(num_threads, 1), stats->interval_seconds, stats->report));
+    }
+    SearchOutcome outcome;
+    if (num_threads <= 1 && checkpoints == nullptr && monitor == nullptr) {
+        outcome = attempt_testing(state, n, 0, t);
+    } else {
+        outcome = search_in_parallel(state, cands, n, k, t, std::max(num_threads, 1), checkpoints, monitor.get());
+    }
+    if (monitor != nullptr) {
+        monitor->finish();
+    }
+    std::copy(state.pruned, state.pruned + kNumPruneReasons, result.pruned);
+    if (target_t != nullptr) {
+        // Report the target we finished with. (We might have found a solution
+        // just as the target came down below its length, though.)
+        result.t = std::min(t, std::max(target_t->load(), (outcome == SearchOutcome::Found) ? state.solution_length : 0));
+    }
+    if (outcome == SearchOutcome::Found) {
+        result.status = NktStatus::Found;
+        result.num_tests = state.solution_length;
+        for (int i = 0; i < state.solution_length; ++i) {
+            static_assert(sizeof(Mask) <= sizeof result.tests[i], "");
+            memcpy(result.tests[i], &state.solution[i], sizeof(Mask));
+        }
+    } else if (outcome == SearchOutcome::Terminated) {
+        result.status = NktStatus::Terminated;
+    } else {
+        result.status = NktStatus::Exhausted;
+    }
 }
 
 template<class A, class B>
-static NktResult solve_wolves_impl(int n, int k, int t, const A& early_terminate, const B& test_is_acceptable)
+static NktResult solve_wolves_impl(int n, int k, int t, const A& early_terminate, const B& test_is_acceptable,
+                                   TranspositionTable *transpositions, const CheckpointSettings *checkpoints,
+                                   const StatsSettings *stats, int num_threads = 1,
+                                   const std::atomic<int> *target_t = nullptr)
 {
     // k wolves hiding among n sheep, given t blood tests
+    if (target_t != nullptr) {
+        t = std::min(t, target_t->load());
+    }
 
     assert(n >= k && k >= 0);
     assert(t >= 0);
-    assert(t < sizeof(Int)*8);
+    assert(n <= kMaxSheep);
 
-    Int nck = choose(n, k);
-    if (ceil_lg(nck) > t) {
-        return NktResult(false,
-            format(
-                "Sorry, information theory tells us that distinguishing %s possibilities requires %d > %d tests.\n",
-                std::to_string(nck).c_str(),
-                ceil_lg(nck), t
-            )
-        );
+    NktResult result;
+    result.n = n;
+    result.k = k;
+    result.t = t;
+    if (ceil_lg(choose(n, k)) > t) {
+        result.status = NktStatus::TooFewTestsForInformation;
+        return result;
     } else if (k == 0 || k == n) {
-        return NktResult(true,
-            format("We know %s of the sheep are wolves, so we don't need any tests!\n", (k == 0) ? "none" : "all")
-        );
+        result.status = NktStatus::NoTestsNeeded;
+        return result;
     } else if (t >= n-1) {
-        return NktResult(true,
-            format("We can obviously test %d sheep one-by-one using %d >= %d-1 blood tests!\n", n, t, n)
-        );
+        result.status = NktStatus::OneByOne;
+        return result;
     } else if (k == n-1) {
-        return NktResult(false,
-            format("Sorry, finding the one real sheep among %d wolves requires %d-1 > %d tests.\n", n, n, t)
-        );
+        result.status = NktStatus::TooFewTestsForOneSheep;
+        return result;
     } else if (k == 1) {
         assert(ceil_lg(n) <= t);
-        return NktResult(true,
-            format("We can test %d sheep for a lone wolf using the binary approach, in %d <= %d blood tests.\n", n, ceil_lg(n), t)
-        );
+        result.status = NktStatus::BinarySearch;
+        return result;
+    }
+
+    // Okay, we have to do it for real. Pick the narrowest mask that holds n sheep.
+    if (n <= 64) {
+        search_for_solution<Int>(result, n, k, t, early_terminate, test_is_acceptable, transpositions, checkpoints, stats, num_threads, target_t);
+    } else if (n <= 128) {
+        search_for_solution<WideMask<2>>(result, n, k, t, early_terminate, test_is_acceptable, transpositions, checkpoints, stats, num_threads, target_t);
     } else {
-        // Okay, we have to do it for real.
-        std::vector<Candidate> cands = make_candidates(n, k);
+        search_for_solution<WideMask<4>>(result, n, k, t, early_terminate, test_is_acceptable, transpositions, checkpoints, stats, num_threads, target_t);
+    }
+    return result;
+}
+
+const char *nkt_status_name(NktStatus status)
+{
+    switch (status) {
+        case NktStatus::TooFewTestsForInformation: return "too-few-tests-for-information";
+        case NktStatus::NoTestsNeeded: return "no-tests-needed";
+        case NktStatus::OneByOne: return "one-by-one";
+        case NktStatus::TooFewTestsForOneSheep: return "too-few-tests-for-one-sheep";
+        case NktStatus::BinarySearch: return "binary-search";
+        case NktStatus::Found: return "found";
+        case NktStatus::Exhausted: return "exhausted";
+        case NktStatus::Terminated: return "terminated";
+    }
+    return "?";
+}
+
+const char *prune_reason_name(PruneReason reason)
+{
+    switch (reason) {
+        case PruneReason::Pigeonhole: return "pigeonhole";
+        case PruneReason::ClassSize: return "class-size";
+        case PruneReason::TwinGroup: return "twin-group";
+        case PruneReason::Transposition: return "transposition";
+    }
+    return "?";
+}
+
+std::string search_stats_line(const SearchStats& s)
+{
+    std::string line = format("STATS n=%d k=%d t=%d state=%s seconds=%.1f nodes=%llu nodes-per-second=%.0f done=%.4f eta=%.0f",
+        s.n, s.k, s.t, s.finished ? "finished" : "running", s.seconds,
+        (unsigned long long)s.nodes, s.nodes_per_second(), s.fraction_done, s.eta_seconds());
+    for (int r = 0; r < kNumPruneReasons; ++r) {
+        line += format(" %s=%llu", prune_reason_name(PruneReason(r)), (unsigned long long)s.pruned[r]);
+    }
+    line += " depths=";
+    for (int i = 0; i < s.t; ++i) {
+        line += format((i == 0) ? "%llu" : ",%llu", (unsigned long long)s.nodes_at_depth[i]);
+    }
+    return line + "\n";
+}
+
+std::string nkt_result_message(const NktResult& r)
+{
+    const int n = r.n;
+    const int k = r.k;
+    const int t = r.t;
+    switch (r.status) {
+        case NktStatus::TooFewTestsForInformation: {
+            Int nck = choose(n, k);
+            return format(
+                "Sorry, information theory tells us that distinguishing %s possibilities requires %d > %d tests.\n",
+                std::to_string(nck).c_str(),
+                ceil_lg(nck), t
+            );
+        }
+        case NktStatus::NoTestsNeeded:
+            return format("We know %s of the sheep are wolves, so we don't need any tests!\n", (k == 0) ? "none" : "all");
+        case NktStatus::OneByOne:
+            return format("We can obviously test %d sheep one-by-one using %d >= %d-1 blood tests!\n", n, t, n);
+        case NktStatus::TooFewTestsForOneSheep:
+            return format("Sorry, finding the one real sheep among %d wolves requires %d-1 > %d tests.\n", n, n, t);
+        case NktStatus::BinarySearch:
+            return format("We can test %d sheep for a lone wolf using the binary approach, in %d <= %d blood tests.\n", n, ceil_lg(n), t);
+        case NktStatus::Found: {
+            std::string message;
+            message += format("Awesome, I think I found a solution using %d blood tests!\n", r.num_tests);
+            message += format("  My %d tests use blood from the following sheep:\n", r.num_tests);
+            for (int i = 0; i < r.num_tests; ++i) {
+                message += format("  %d.%s", i+1, (i >= 9) ? "" : " ");
+                for (int sheep = 0; sheep < n; ++sheep) {
+                    message += format(" %c", r.test_uses_sheep(i, sheep) ? 'T' : '.');
+                }
+                message += format("\n");
+            }
 #if 0
-        for (auto&& cand : cands) {
-            printf("Candidate wolves:");
-            for (int i=0; i < n; ++i) {
-                bool sheep_is_wolf = (cand.is_wolf & (Int(1) << i)) != 0;
-                printf(" %d", sheep_is_wolf ? 1 : 0);
+            message += format("The test results for each arrangement of wolves are:\n");
+            for (Int is_wolf : make_candidates<Int>(n, k)) {
+                message += format("Candidate wolves:");
+                for (int i=0; i < n; ++i) {
+                    bool sheep_is_wolf = (is_wolf & (Int(1) << i)) != 0;
+                    message += format(" %d", sheep_is_wolf ? 1 : 0);
+                }
+                message += format("   Test results: ");
+                for (int i=0; i < r.num_tests; ++i) {
+                    bool test_was_positive = (r.tests[i][0] & is_wolf) != 0;
+                    message += format(" %c", test_was_positive ? '+' : '-');
+                }
+                message += format("\n");
             }
-            printf("\n");
-        }
 #endif
-        TestingState<A, B> state(early_terminate, test_is_acceptable);
-        state.cands = std::move(cands);
-        state.solution.resize(t);
-        try {
-            attempt_testing(state, n, 0, t);
-        } catch (const NktResult& result) {
-            assert(result.success == true);
-            return result;
+            return message;
         }
-        return NktResult(false,
-            format("I believe it's impossible to detect %d wolves among %d sheep in only %d tests.\n", k, n, t)
-        );
+        case NktStatus::Exhausted:
+            return format("I believe it's impossible to detect %d wolves among %d sheep in only %d tests.\n", k, n, t);
+        case NktStatus::Terminated:
+            return format("I was told to stop looking for %d wolves among %d sheep in %d tests.\n", k, n, t);
     }
+    return std::string();
 }
 
 NktResult solve_wolves(int n, int k, int t)
 {
     auto early_terminate = []() { return false; };
-    auto test_is_acceptable = [](Int) { return true; };
-    return solve_wolves_impl(n, k, t, early_terminate, test_is_acceptable);
+    auto test_is_acceptable = [](const auto&) { return true; };
+    return solve_wolves_impl(n, k, t, early_terminate, test_is_acceptable, g_transposition_table.get(), checkpoint_settings(), stats_settings());
 }
 
 NktResult solve_wolves(int n, int k, int t, int s)
 {
     auto early_terminate = []() { return false; };
-    auto test_is_acceptable = [s](Int m) { return popcount(m) == s; };
-    return solve_wolves_impl(n, k, t, early_terminate, test_is_acceptable);
+    auto test_is_acceptable = [s](const auto& m) { return popcount(m) == s; };
+    // Positions that are hopeless with only s-animal tests might not be hopeless
+    // in general, so don't share them with the table.
+    return solve_wolves_impl(n, k, t, early_terminate, test_is_acceptable, nullptr, nullptr, nullptr);
 }
 
 NktResult solve_wolves(int n, int k, int t, std::function<bool()> early_terminate)
 {
-    auto test_is_acceptable = [](Int) { return true; };
-    return solve_wolves_impl(n, k, t, early_terminate, test_is_acceptable);
+    auto test_is_acceptable = [](const auto&) { return true; };
+    return solve_wolves_impl(n, k, t, early_terminate, test_is_acceptable, g_transposition_table.get(), checkpoint_settings(), stats_settings());
+}
+
+NktResult solve_wolves(int n, int k, int t, std::function<bool()> early_terminate, int num_threads)
+{
+    auto test_is_acceptable = [](const auto&) { return true; };
+    return solve_wolves_impl(n, k, t, early_terminate, test_is_acceptable, g_transposition_table.get(), checkpoint_settings(), stats_settings(), num_threads);
+}
+
+NktResult solve_wolves(int n, int k, int t, std::function<bool()> early_terminate, int num_threads, const std::atomic<int> *target_t)
+{
+    auto test_is_acceptable = [](const auto&) { return true; };
+    return solve_wolves_impl(n, k, t, early_terminate, test_is_acceptable, g_transposition_table.get(), checkpoint_settings(), stats_settings(), num_threads, target_t);
+}
+
+void solve_wolves_use_transposition_table(size_t bytes)
+{
+    if (bytes == 0) {
+        g_transposition_table = nullptr;
+    } else {
+        g_transposition_table.reset(new TranspositionTable(bytes));
+    }
+}
+
+void solve_wolves_use_checkpoints(const std::string& directory, int interval_seconds, bool resume)
+{
+    g_checkpoint_settings.directory = directory;
+    g_checkpoint_settings.interval_seconds = interval_seconds;
+    g_checkpoint_settings.resume = resume;
+}
+
+void solve_wolves_report_stats(int interval_seconds, std::function<void(const SearchStats&)> report)
+{
+    g_stats_settings.interval_seconds = (report != nullptr) ? interval_seconds : 0;
+    g_stats_settings.report = std::move(report);
 }
@@ -1,17 +1,128 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <stddef.h>
+#include <stdint.h>
 #include <string>
 
-struct EarlyTerminateException {};
+// The solver handles up to this many sheep; since t < n-1 whenever it
+// actually searches, that's also a bound on the number of tests in a solution.
+static constexpr int kMaxSheep = 256;
 
+enum class NktStatus {
+    TooFewTestsForInformation,  // C(n,k) > 2^t, so it's impossible
+    NoTestsNeeded,              // k == 0 or k == n
+    OneByOne,                   // t >= n-1: test each sheep but the last
+    TooFewTestsForOneSheep,     // k == n-1, and finding the sheep takes n-1 tests
+    BinarySearch,               // k == 1 and 2^t >= n
+    Found,                      // the search found the tests below
+    Exhausted,                  // the search found that it's impossible
+    Terminated,                 // early_terminate told us to stop
+};
+
+// A short name for each status, e.g. "found", for sending results around as text.
+const char *nkt_status_name(NktStatus status);
+
+// The ways the search can rule out a position early. See lower_bounds.h.
+enum class PruneReason {
+    Pigeonhole,     // the untested animals won't fit into the remaining tests
+    ClassSize,      // too many candidates still look alike for the remaining tests
+    TwinGroup,      // a group of not-yet-distinguished sheep is too big for the remaining tests
+    Transposition,  // the transposition table already knows it's hopeless
+};
+static constexpr int kNumPruneReasons = 4;
+
+const char *prune_reason_name(PruneReason reason);
+
+// The outcome of a search. This is plain data, cheap to produce even when
+// searches are being cancelled all the time; call nkt_result_message()
+// to turn it into prose.
 struct NktResult {
-    bool success;
-    std::string message;
-    explicit NktResult(bool success, std::string msg) : success(success), message(std::move(msg)) {}
+    NktStatus status = NktStatus::Terminated;
+    int n = 0;
+    int k = 0;
+    int t = 0;
+    // If status is Found, tests[i] is the set of sheep in test i, for i < num_tests.
+    int num_tests = 0;
+    uint64_t tests[kMaxSheep][kMaxSheep / 64] = {};
+    // How many positions each PruneReason ruled out, summed over all threads.
+    uint64_t pruned[kNumPruneReasons] = {};
+
+    bool success() const {
+        return status == NktStatus::NoTestsNeeded || status == NktStatus::OneByOne ||
+               status == NktStatus::BinarySearch || status == NktStatus::Found;
+    }
+    bool test_uses_sheep(int i, int sheep) const {
+        return (tests[i][sheep / 64] >> (sheep % 64)) & 1;
+    }
 };
 
+std::string nkt_result_message(const NktResult& result);
+
+// A snapshot of a search in progress, with its counters summed over all threads.
+struct SearchStats {
+    int n = 0;
+    int k = 0;
+    int t = 0;
+    bool finished = false;
+    double seconds = 0;
+    uint64_t nodes = 0;
+    // nodes_at_depth[i] is how many of those nodes had i tests chosen, for i < t.
+    uint64_t nodes_at_depth[kMaxSheep] = {};
+    uint64_t pruned[kNumPruneReasons] = {};
+    // The fraction of the top-level subtrees that we've finished searching.
+    double fraction_done = 0;
+
+    double nodes_per_second() const {
+        return (seconds > 0) ? nodes / seconds : 0;
+    }
+    // A crude guess that assumes the unfinished subtrees are as big as the
+    // finished ones; -1 until we've finished at least one.
+    double eta_seconds() const {
+        return (fraction_done > 0) ? seconds * (1 - fraction_done) / fraction_done : -1;
+    }
+};
+
+// One line of "key=value" pairs, beginning with "STATS", for a log or a script.
+std::string search_stats_line(const SearchStats& stats);
+
 NktResult solve_wolves(int n, int k, int t);
 NktResult solve_wolves(int n, int k, int t, std::function<bool()> early_terminate);
 
+// Search using num_threads threads; the first one to find a solution wins.
+// early_terminate is polled concurrently from all of them.
+NktResult solve_wolves(int n, int k, int t, std::function<bool()> early_terminate, int num_threads);
+
+// The same, except that other threads may lower *target_t (but never raise it)
+// while we search, and from then on we look only for solutions with at most
+// *target_t tests. Nothing we've searched so far needs searching again: if a
+// subtree holds no solution in t tests, it holds none in fewer. The result's t
+// is the target we finished with; or, if the target came down just as we
+// found a solution, the length of that solution.
+NktResult solve_wolves(int n, int k, int t, std::function<bool()> early_terminate, int num_threads,
+                       const std::atomic<int> *target_t);
+
 NktResult solve_wolves(int n, int k, int t, int s);
+
+// Share a table (of about this many bytes) of hopeless search positions among all
+// subsequent searches; zero turns it off. Call this before starting any searches.
+// A position is keyed on its exact tests so far, so the table prunes only what
+// was already searched (barring a collision of 64-bit hashes); it pays off when
+// the same (n,k) is searched again with as many tests or fewer.
+void solve_wolves_use_transposition_table(size_t bytes);
+
+// Every interval_seconds, save what's left of each search to a file in this
+// directory named after its (n,k,t). An interrupted search saves its file one
+// last time; a search that runs to completion removes it. If resume is true,
+// a search whose file already exists picks up where that file left off.
+// An empty directory turns checkpointing off. Call this before starting any searches.
+void solve_wolves_use_checkpoints(const std::string& directory, int interval_seconds, bool resume);
+
+// Every interval_seconds, call report with a snapshot of each search that's
+// still running; a search that got at least one such call gets a last one
+// (with finished set) when it ends. The calls come from the searching threads
+// themselves, so report should be quick. Zero turns it off. Counting costs
+// the search next to nothing; each thread publishes its own counters only
+// every so often. Call this before starting any searches.
+void solve_wolves_report_stats(int interval_seconds, std::function<void(const SearchStats&)> report);